@@ -7,6 +7,7 @@ class ServiceMenu {
         this.settingsForm = document.getElementById('settingsForm');
         this.exportButton = document.getElementById('exportData');
         this.resetWifiButton = document.getElementById('resetWifi');
+        this.resetStatsButton = document.getElementById('resetStats');
         
         // Store form input references
         this.tempUpdateInput = this.settingsForm?.querySelector('[name="tempUpdateInterval"]');
@@ -33,6 +34,7 @@ class ServiceMenu {
         // Export and reset handlers
         this.exportButton?.addEventListener('click', () => this.handleDataExport());
         this.resetWifiButton?.addEventListener('click', () => this.handleWifiReset());
+        this.resetStatsButton?.addEventListener('click', () => this.handleStatsReset());
         
         // Screen size change handler
         window.addEventListener('resize', () => {
@@ -48,11 +50,40 @@ class ServiceMenu {
         const tempInput = this.settingsForm.querySelector('[name="tempUpdateInterval"]');
         const loggingInput = this.settingsForm.querySelector('[name="loggingInterval"]');
         const maxEntriesInput = this.settingsForm.querySelector('[name="maxLogEntries"]');
+        const resolutionModeInput = this.settingsForm.querySelector('[name="resolutionMode"]');
+        const resolutionInput = this.settingsForm.querySelector('[name="sensorResolution"]');
+        const commitRecordsInput = this.settingsForm.querySelector('[name="commitRecords"]');
+        const commitSecondsInput = this.settingsForm.querySelector('[name="commitSeconds"]');
+        const compressionModeInput = this.settingsForm.querySelector('[name="compressionMode"]');
+        const toleranceInput = this.settingsForm.querySelector('[name="compressionTolerance"]');
+        const heartbeatInput = this.settingsForm.querySelector('[name="heartbeatSeconds"]');
+        const windowsInput = this.settingsForm.querySelector('[name="statsWindows"]');
+        const histogramMinInput = this.settingsForm.querySelector('[name="histogramMin"]');
+        const histogramMaxInput = this.settingsForm.querySelector('[name="histogramMax"]');
+        const binWidthInput = this.settingsForm.querySelector('[name="histogramBinWidth"]');
+        const anomalySpanInput = this.settingsForm.querySelector('[name="anomalySpan"]');
+        const anomalyThresholdInput = this.settingsForm.querySelector('[name="anomalyThreshold"]');
         
         const settings = {
             tempUpdateInterval: parseInt(tempInput.value),
             loggingInterval: parseInt(loggingInput.value),
-            maxLogEntries: parseInt(maxEntriesInput.value)
+            maxLogEntries: parseInt(maxEntriesInput.value),
+            resolutionMode: resolutionModeInput.value,
+            sensorResolution: parseInt(resolutionInput.value),
+            commitRecords: parseInt(commitRecordsInput.value),
+            commitSeconds: parseInt(commitSecondsInput.value),
+            compressionMode: compressionModeInput.value,
+            compressionTolerance: parseFloat(toleranceInput.value),
+            heartbeatSeconds: parseInt(heartbeatInput.value),
+            statsWindows: windowsInput.value.split(',')
+                .map(value => value.trim())
+                .filter(value => value !== '')
+                .map(value => Number(value)),
+            histogramMin: parseFloat(histogramMinInput.value),
+            histogramMax: parseFloat(histogramMaxInput.value),
+            histogramBinWidth: parseFloat(binWidthInput.value),
+            anomalySpan: parseInt(anomalySpanInput.value),
+            anomalyThreshold: parseFloat(anomalyThresholdInput.value)
         };
 
         // Validate settings
@@ -92,10 +123,36 @@ class ServiceMenu {
             const tempInput = this.settingsForm?.querySelector('[name="tempUpdateInterval"]');
             const loggingInput = this.settingsForm?.querySelector('[name="loggingInterval"]');
             const maxEntriesInput = this.settingsForm?.querySelector('[name="maxLogEntries"]');
+            const resolutionModeInput = this.settingsForm?.querySelector('[name="resolutionMode"]');
+            const resolutionInput = this.settingsForm?.querySelector('[name="sensorResolution"]');
+            const commitRecordsInput = this.settingsForm?.querySelector('[name="commitRecords"]');
+            const commitSecondsInput = this.settingsForm?.querySelector('[name="commitSeconds"]');
+            const compressionModeInput = this.settingsForm?.querySelector('[name="compressionMode"]');
+            const toleranceInput = this.settingsForm?.querySelector('[name="compressionTolerance"]');
+            const heartbeatInput = this.settingsForm?.querySelector('[name="heartbeatSeconds"]');
+            const windowsInput = this.settingsForm?.querySelector('[name="statsWindows"]');
+            const histogramMinInput = this.settingsForm?.querySelector('[name="histogramMin"]');
+            const histogramMaxInput = this.settingsForm?.querySelector('[name="histogramMax"]');
+            const binWidthInput = this.settingsForm?.querySelector('[name="histogramBinWidth"]');
+            const anomalySpanInput = this.settingsForm?.querySelector('[name="anomalySpan"]');
+            const anomalyThresholdInput = this.settingsForm?.querySelector('[name="anomalyThreshold"]');
             
             if (tempInput) tempInput.value = settings.tempUpdateInterval;
             if (loggingInput) loggingInput.value = settings.loggingInterval;
             if (maxEntriesInput) maxEntriesInput.value = settings.maxLogEntries;
+            if (resolutionModeInput) resolutionModeInput.value = settings.resolutionMode;
+            if (resolutionInput) resolutionInput.value = settings.sensorResolution;
+            if (commitRecordsInput) commitRecordsInput.value = settings.commitRecords;
+            if (commitSecondsInput) commitSecondsInput.value = settings.commitSeconds;
+            if (compressionModeInput) compressionModeInput.value = settings.compressionMode;
+            if (toleranceInput) toleranceInput.value = settings.compressionTolerance;
+            if (heartbeatInput) heartbeatInput.value = settings.heartbeatSeconds;
+            if (windowsInput) windowsInput.value = (settings.statsWindows ?? []).join(', ');
+            if (histogramMinInput) histogramMinInput.value = settings.histogramMin;
+            if (histogramMaxInput) histogramMaxInput.value = settings.histogramMax;
+            if (binWidthInput) binWidthInput.value = settings.histogramBinWidth;
+            if (anomalySpanInput) anomalySpanInput.value = settings.anomalySpan;
+            if (anomalyThresholdInput) anomalyThresholdInput.value = settings.anomalyThreshold;
         } catch (error) {
             showStatus('Failed to load settings', 'error');
         }
@@ -141,6 +198,48 @@ class ServiceMenu {
             showStatus('Max log entries must be between 100-10000', 'error');
             return false;
         }
+        if (!Number.isInteger(settings.sensorResolution) || settings.sensorResolution < 9 || settings.sensorResolution > 12) {
+            showStatus('Sensor resolution must be between 9-12 bits', 'error');
+            return false;
+        }
+        if (!Number.isInteger(settings.commitRecords) || settings.commitRecords < 1 || settings.commitRecords > 64) {
+            showStatus('Readings per flash write must be between 1-64', 'error');
+            return false;
+        }
+        if (!Number.isInteger(settings.commitSeconds) || settings.commitSeconds < 1 || settings.commitSeconds > 3600) {
+            showStatus('Maximum write delay must be between 1-3600 seconds', 'error');
+            return false;
+        }
+        if (!(settings.compressionTolerance >= 0.01 && settings.compressionTolerance <= 5)) {
+            showStatus('Compression tolerance must be between 0.01-5°C', 'error');
+            return false;
+        }
+        if (!Number.isInteger(settings.heartbeatSeconds) || settings.heartbeatSeconds < 60 || settings.heartbeatSeconds > 86400) {
+            showStatus('Compression heartbeat must be between 60-86400 seconds', 'error');
+            return false;
+        }
+        if (settings.statsWindows.length > 4 ||
+            !settings.statsWindows.every(seconds => Number.isInteger(seconds) && seconds >= 60 && seconds <= 86400)) {
+            showStatus('Use up to 4 statistics windows of 60-86400 seconds each', 'error');
+            return false;
+        }
+        if (!(settings.histogramMin >= -55 && settings.histogramMax <= 125 && settings.histogramMin < settings.histogramMax)) {
+            showStatus('Histogram range must be increasing and within -55-125°C', 'error');
+            return false;
+        }
+        if (!(settings.histogramBinWidth >= 0.05 && settings.histogramBinWidth <= 10) ||
+            Math.ceil((settings.histogramMax - settings.histogramMin) / settings.histogramBinWidth) > 512) {
+            showStatus('Histogram bin width must be 0.05-10°C, with at most 512 bins', 'error');
+            return false;
+        }
+        if (!Number.isInteger(settings.anomalySpan) || settings.anomalySpan < 10 || settings.anomalySpan > 10000) {
+            showStatus('Anomaly baseline must be between 10-10000 readings', 'error');
+            return false;
+        }
+        if (!(settings.anomalyThreshold >= 2 && settings.anomalyThreshold <= 10)) {
+            showStatus('Anomaly threshold must be between 2-10 standard deviations', 'error');
+            return false;
+        }
         return true;
     }
 
@@ -185,4 +284,20 @@ class ServiceMenu {
             }
         }
     }
-} 
\ No newline at end of file
+
+    async handleStatsReset() {
+        try {
+            const response = await fetch('/api/stats/reset', {
+                method: 'POST'
+            });
+
+            if (response.ok) {
+                showStatus('Statistics reset');
+            } else {
+                showStatus('Failed to reset statistics', 'error');
+            }
+        } catch (error) {
+            showStatus('Failed to reset statistics', 'error');
+        }
+    }
+}
@@ -5,8 +5,23 @@ const reconnectDelay = 5000;
 
 // Temperature history management
 const maxDataPoints = 50;  // Maximum number of points to show on the graph
+const primarySensor = 0;   // Sensor shown on the dashboard
+
+// Live updates arrive as packed binary frames, see WebServerManager::BinaryReading
+const wsBinaryProtocol = 'temperature.bin';
+const FRAME_READING = 1;
+const FRAME_RESYNC = 2;
+const FRAME_SNAPSHOT = 3;
+const FRAME_ALERT = 4;
+
+// Every live reading carries a sequence number; gaps are fetched over the socket
+const resendTimeout = 5000;
+let lastSeq = null;
+let resendRequestedAt = null;
+let firstChartReported = false;
 let temperatureHistory = [];
-let totalSamples = 0;  // Add this after temperatureHistory declaration
+let deviceStats = null;  // Statistics since reset of the primary sensor, kept by the device
+const activeAlerts = new Map();  // Raised alerts by rule index
 
 // Initialize the chart with proper configuration
 const ctx = document.getElementById('tempChart').getContext('2d');
@@ -20,8 +35,11 @@ const tempChart = new Chart(ctx, {
             backgroundColor: 'rgba(59, 130, 246, 0.1)',
             tension: 0.3,
             fill: true,
-            pointRadius: 3,
-            pointHoverRadius: 5
+            // Readings the device flagged as anomalous stand out in red
+            pointRadius: context => context.raw?.flags ? 5 : 3,
+            pointHoverRadius: 5,
+            pointBackgroundColor: context => context.raw?.flags ? 'rgb(220, 38, 38)' : 'rgba(59, 130, 246, 0.1)',
+            pointBorderColor: context => context.raw?.flags ? 'rgb(220, 38, 38)' : 'rgb(59, 130, 246)'
         }]
     },
     options: {
@@ -59,7 +77,8 @@ const tempChart = new Chart(ctx, {
             tooltip: {
                 callbacks: {
                     label: function(context) {
-                        return `Temperature: ${context.parsed.y.toFixed(1)}°C`;
+                        const label = `Temperature: ${context.parsed.y.toFixed(1)}°C`;
+                        return context.raw?.flags ? `${label} (anomaly)` : label;
                     }
                 }
             }
@@ -67,9 +86,9 @@ const tempChart = new Chart(ctx, {
     }
 });
 
+// Statistics come from the device with every live reading, or from /api/stats
 function updateStatistics() {
-    // Reset stats if no data
-    if (temperatureHistory.length === 0) {
+    if (!deviceStats || deviceStats.count === 0) {
         document.getElementById('min-temp').textContent = '--.-';
         document.getElementById('max-temp').textContent = '--.-';
         document.getElementById('avg-temp').textContent = '--.-';
@@ -77,21 +96,89 @@ function updateStatistics() {
         return;
     }
 
-    const temperatures = temperatureHistory.map(item => item.temp);
-    const min = Math.min(...temperatures);
-    const max = Math.max(...temperatures);
-    const avg = temperatures.reduce((a, b) => a + b) / temperatures.length;
+    document.getElementById('min-temp').textContent = deviceStats.min.toFixed(1);
+    document.getElementById('max-temp').textContent = deviceStats.max.toFixed(1);
+    document.getElementById('avg-temp').textContent = deviceStats.mean.toFixed(1);
+    document.getElementById('sample-count').textContent = deviceStats.count.toString();
+}
+
+async function loadStatistics() {
+    try {
+        const response = await fetch('/api/stats');
+        if (!response.ok) {
+            throw new Error('Failed to load statistics');
+        }
+
+        const data = await response.json();
+        const sensor = (data.sensors ?? []).find(entry => entry.sensor === primarySensor);
+        deviceStats = sensor ? sensor.sinceReset : null;
+        updateStatistics();
+    } catch (error) {
+        console.warn('Could not load statistics:', error);
+    }
+}
+
+function describeAlert(alert) {
+    const sensor = `Sensor ${alert.sensor}`;
+    switch (alert.type) {
+        case 'above':
+            return `${sensor} above ${alert.threshold.toFixed(1)}°C (${alert.value.toFixed(1)}°C)`;
+        case 'below':
+            return `${sensor} below ${alert.threshold.toFixed(1)}°C (${alert.value.toFixed(1)}°C)`;
+        case 'rate':
+            return `${sensor} changing faster than ${alert.threshold.toFixed(1)}°C/min (${alert.value.toFixed(1)}°C/min)`;
+        case 'missing':
+            return `${sensor} silent for over ${Math.round(alert.threshold)}s`;
+        default:
+            return `${sensor} alert`;
+    }
+}
+
+function updateAlerts() {
+    const list = document.getElementById('alert-list');
+    list.replaceChildren(...[...activeAlerts.values()].map(alert => {
+        const item = document.createElement('li');
+        item.textContent = describeAlert(alert);
+        return item;
+    }));
+    document.getElementById('alerts').classList.toggle('hidden', activeAlerts.size === 0);
+}
+
+function handleAlert(alert) {
+    if (alert.active) {
+        activeAlerts.set(alert.rule, alert);
+    } else {
+        activeAlerts.delete(alert.rule);
+    }
+    updateAlerts();
+}
+
+// Alerts raised before the page connected aren't resent over the socket
+async function loadAlerts() {
+    try {
+        const response = await fetch('/api/alerts');
+        if (!response.ok) {
+            throw new Error('Failed to load alerts');
+        }
 
-    document.getElementById('min-temp').textContent = min.toFixed(1);
-    document.getElementById('max-temp').textContent = max.toFixed(1);
-    document.getElementById('avg-temp').textContent = avg.toFixed(1);
-    document.getElementById('sample-count').textContent = totalSamples.toString();
+        const data = await response.json();
+        activeAlerts.clear();
+        (data.rules ?? []).forEach((rule, index) => {
+            if (rule.active) {
+                activeAlerts.set(index, { ...rule, rule: index });
+            }
+        });
+        updateAlerts();
+    } catch (error) {
+        console.warn('Could not load alerts:', error);
+    }
 }
 
 function updateChart() {
     const chartData = temperatureHistory.map(item => ({
         x: new Date(new Date().toDateString() + ' ' + item.timestamp),
-        y: item.temp
+        y: item.temp,
+        flags: item.flags ?? 0
     }));
 
     tempChart.data.datasets[0].data = chartData;
@@ -106,7 +193,7 @@ function updateDisplays(temperature, timestamp) {
     document.getElementById('last-update').textContent = `Last update: ${timestamp}`;
 }
 
-function addTemperatureReading(temperature, timestamp) {
+function addTemperatureReading(temperature, timestamp, epoch, flags = 0) {
     if (isNaN(temperature) || temperature === null) {
         console.error('Invalid temperature reading:', temperature);
         return;
@@ -114,12 +201,13 @@ function addTemperatureReading(temperature, timestamp) {
 
     const reading = {
         timestamp: timestamp,  // Use the timestamp string directly
-        temp: parseFloat(temperature)
+        epoch: epoch,
+        temp: parseFloat(temperature),
+        flags: flags
     };
 
     // Add to history while maintaining maxDataPoints limit
     temperatureHistory.push(reading);
-    totalSamples++; // Increment total samples counter
     if (temperatureHistory.length > maxDataPoints) {
         temperatureHistory.shift();
     }
@@ -134,7 +222,8 @@ function initWebSocket() {
     const protocol = window.location.protocol === 'https:' ? 'wss:' : 'ws:';
     const wsUrl = `${protocol}//${window.location.host}/ws`;
     
-    ws = new WebSocket(wsUrl);
+    ws = new WebSocket(wsUrl, wsBinaryProtocol);
+    ws.binaryType = 'arraybuffer';
     
     ws.onopen = () => {
         console.log('WebSocket connected');
@@ -160,28 +249,189 @@ function initWebSocket() {
     
     ws.onmessage = async (event) => {
         try {
-            const data = JSON.parse(event.data);
-            console.log('WebSocket message received:', data);
+            const data = typeof event.data === 'string'
+                ? JSON.parse(event.data)
+                : decodeBinaryFrame(event.data);
+            if (!data) {
+                return;
+            }
+            
+            if (data.snapshot) {
+                await applySnapshot(data);
+                return;
+            }
+            
+            if (data.alert) {
+                handleAlert(data);
+                return;
+            }
             
-            if (data.update && data.temperature !== undefined && data.timestamp !== undefined) {
-                // Update display immediately
-                document.getElementById('temperature').textContent = 
-                    parseFloat(data.temperature).toFixed(1);
-                document.getElementById('last-update').textContent = 
-                    `Last update: ${data.timestamp}`;
-                
-                // Small delay to ensure the JSON file is updated
-                await new Promise(resolve => setTimeout(resolve, 100));
-                
-                // Update from JSON file
+            if (data.resync) {
+                // The readings we missed are gone from the device's window
+                lastSeq = data.seq;
+                resendRequestedAt = null;
                 await updateFromJSON();
+                return;
             }
+            
+            handleLiveReading(data);
         } catch (error) {
             console.error('Error processing WebSocket message:', error);
         }
     };
 }
 
+// Apply readings strictly in sequence, asking for any gap instead of refetching history
+function handleLiveReading(data) {
+    if (lastSeq !== null) {
+        if (data.seq <= lastSeq) {
+            return;  // Already applied, e.g. also part of a resend
+        }
+        if (data.seq > lastSeq + 1) {
+            // The resend covers this reading too, so wait for it in order
+            if (resendRequestedAt === null || Date.now() - resendRequestedAt > resendTimeout) {
+                requestResend();
+            }
+            return;
+        }
+    }
+
+    lastSeq = data.seq;
+    resendRequestedAt = null;
+
+    if (data.sensor !== primarySensor || data.temperature === undefined) {
+        return;
+    }
+    if (data.stats) {
+        deviceStats = data.stats;
+    }
+    addTemperatureReading(data.temperature, data.timestamp, data.epoch, data.flags ?? 0);
+}
+
+// The device sends its recent readings right after connecting
+async function applySnapshot(snapshot) {
+    lastSeq = snapshot.seq;
+    resendRequestedAt = null;
+
+    const lastEpoch = temperatureHistory.length > 0
+        ? temperatureHistory[temperatureHistory.length - 1].epoch ?? 0
+        : 0;
+    const readings = snapshot.readings
+        .filter(reading => reading.sensor === primarySensor && reading.epoch > lastEpoch)
+        .map(reading => ({
+            timestamp: reading.timestamp,
+            epoch: reading.epoch,
+            temp: reading.temperature,
+            flags: reading.flags ?? 0
+        }));
+
+    if (temperatureHistory.length === 0 && readings.length === 0) {
+        // Nothing recent in memory on the device, fall back to the stored history
+        await loadHistory();
+    } else {
+        temperatureHistory = temperatureHistory.concat(readings).slice(-maxDataPoints);
+        if (temperatureHistory.length > 0) {
+            const latest = temperatureHistory[temperatureHistory.length - 1];
+            updateDisplays(latest.temp, latest.timestamp);
+        }
+        updateChart();
+    }
+
+    // Live readings bring statistics and alerts from here on
+    await loadStatistics();
+    await loadAlerts();
+    reportFirstChart();
+}
+
+// Tell the device how long it took from page load to the first chart
+function reportFirstChart() {
+    if (firstChartReported || !ws || ws.readyState !== WebSocket.OPEN) {
+        return;
+    }
+    firstChartReported = true;
+    ws.send(JSON.stringify({ firstChartMs: Math.round(performance.now()) }));
+}
+
+function requestResend() {
+    if (ws && ws.readyState === WebSocket.OPEN) {
+        ws.send(JSON.stringify({ resend: lastSeq + 1 }));
+        resendRequestedAt = Date.now();
+    }
+}
+
+// Decode a binary reading frame into the same shape as the JSON messages
+function decodeBinaryFrame(buffer) {
+    const view = new DataView(buffer);
+    if (view.byteLength < 12) {
+        return null;
+    }
+
+    const type = view.getUint8(0);
+    const seq = view.getUint32(8, true);
+    if (type === FRAME_RESYNC) {
+        return { resync: true, seq };
+    }
+    if (type === FRAME_ALERT && view.byteLength >= 20) {
+        // Temperatures and rates come in hundredths, missing times in seconds
+        const alertType = ['above', 'below', 'rate', 'missing'][view.getUint8(3)];
+        const scale = alertType === 'missing' ? 1 : 100;
+        return {
+            alert: true,
+            sensor: view.getUint8(1),
+            rule: view.getUint8(2),
+            type: alertType,
+            epoch: view.getUint32(4, true),
+            active: view.getUint8(8) === 1,
+            value: view.getInt32(12, true) / scale,
+            threshold: view.getInt32(16, true) / scale
+        };
+    }
+    if (type === FRAME_SNAPSHOT) {
+        const count = view.getUint16(2, true);
+        const readings = [];
+        for (let i = 0; i < count && 12 + (i + 1) * 8 <= view.byteLength; i++) {
+            const offset = 12 + i * 8;
+            const epoch = view.getUint32(offset, true);
+            readings.push({
+                seq: seq - count + 1 + i,
+                epoch,
+                temperature: view.getInt16(offset + 4, true) / 100,
+                sensor: view.getUint8(offset + 6),
+                flags: view.getUint8(offset + 7),
+                timestamp: new Date(epoch * 1000).toLocaleTimeString('en-GB', { hour12: false })
+            });
+        }
+        return { snapshot: true, seq, total: view.getUint32(4, true), readings };
+    }
+    if (type !== FRAME_READING) {
+        return null;
+    }
+
+    const epoch = view.getUint32(4, true);
+    const time = epoch > 0 ? new Date(epoch * 1000) : new Date();
+    const reading = {
+        seq,
+        sensor: view.getUint8(1),
+        temperature: view.getInt16(2, true) / 100,
+        timestamp: time.toLocaleTimeString('en-GB', { hour12: false }),
+        flags: view.byteLength >= 16 ? view.getUint8(12) : 0
+    };
+
+    // Live readings carry the statistics since reset, see WebServerManager::BinaryStats
+    if (view.byteLength >= 36) {
+        reading.stats = {
+            count: view.getUint32(16, true),
+            min: view.getInt16(20, true) / 100,
+            max: view.getInt16(22, true) / 100,
+            mean: view.getInt16(24, true) / 100,
+            stddev: view.getUint16(26, true) / 100,
+            minEpoch: view.getUint32(28, true),
+            maxEpoch: view.getUint32(32, true)
+        };
+    }
+    return reading;
+}
+
 // Handle WiFi configuration form
 document.getElementById('wifi-form')?.addEventListener('submit', async (e) => {
     e.preventDefault();
@@ -210,25 +460,22 @@ document.getElementById('wifi-form')?.addEventListener('submit', async (e) => {
     }
 });
 
-// Initialize monitoring with latest temperature
-async function initializeMonitoring() {
+// Load the stored history over HTTP, used when the device has no recent readings in memory
+async function loadHistory() {
     try {
-        // Load historical data first
-        const response = await fetch('/api/temperature/history');
+        const response = await fetch(`/api/temperature/history?limit=${maxDataPoints}&sensor=${primarySensor}`);
         if (!response.ok) {
             throw new Error('Failed to load historical data');
         }
         
         const data = await response.json();
         if (data.readings && Array.isArray(data.readings)) {
-            // Set total samples to the total number of readings in history
-            totalSamples = data.readings.length;
-            
             // Convert the last maxDataPoints readings into our format
             temperatureHistory = data.readings
                 .slice(-maxDataPoints)
                 .map(reading => ({
                     timestamp: reading.timestamp,
+                    epoch: reading.epoch,
                     temp: parseFloat(reading.temperature)
                 }));
             
@@ -238,15 +485,15 @@ async function initializeMonitoring() {
                 updateDisplays(latest.temp, latest.timestamp);
             }
             
-            // Update statistics and chart
-            updateStatistics();
             updateChart();
         }
     } catch (error) {
         console.warn('Could not load historical data:', error);
     }
-    
-    // Initialize WebSocket after loading initial data
+}
+
+// Initialize monitoring, the first WebSocket message carries a snapshot to draw from
+function initializeMonitoring() {
     initWebSocket();
 }
 
@@ -277,28 +524,25 @@ function handleWebSocketMessage(event) {
 // Update from JSON without adding duplicate entries
 async function updateFromJSON() {
     try {
-        const response = await fetch('/api/temperature/history');
+        const response = await fetch(`/api/temperature/history?limit=${maxDataPoints}&sensor=${primarySensor}`);
         if (!response.ok) {
             throw new Error('Failed to load temperature data');
         }
         
         const data = await response.json();
         if (data.readings && Array.isArray(data.readings)) {
-            // Update total samples count
-            totalSamples = data.readings.length;
-            
             // Get the most recent readings up to maxDataPoints
             const newHistory = data.readings
                 .slice(-maxDataPoints)
                 .map(reading => ({
                     timestamp: reading.timestamp,
+                    epoch: reading.epoch,
                     temp: parseFloat(reading.temperature)
                 }));
             
             // Only update if the data has actually changed
             if (JSON.stringify(newHistory) !== JSON.stringify(temperatureHistory)) {
                 temperatureHistory = newHistory;
-                updateStatistics();
                 updateChart();
             }
         }
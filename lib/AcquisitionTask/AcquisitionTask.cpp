@@ -0,0 +1,108 @@
+#include "AcquisitionTask.h"
+
+AcquisitionTask::AcquisitionTask(SensorManager* sensorManager, unsigned long sampleIntervalMs)
+    : sensorManager(sensorManager)
+    , anomalyDetector(nullptr)
+    , taskHandle(nullptr)
+    , sampleInterval(sampleIntervalMs)
+    , lastSampleTime(0)
+    , tick(0)
+    , droppedSamples(0)
+    , configLock(portMUX_INITIALIZER_UNLOCKED)
+    , configPending(false)
+{
+}
+
+bool AcquisitionTask::begin(BaseType_t core, UBaseType_t priority) {
+    if (taskHandle) {
+        return true;
+    }
+
+    lastSampleTime = millis();
+    BaseType_t result = xTaskCreatePinnedToCore(taskEntry, "acquisition", STACK_SIZE,
+                                                this, priority, &taskHandle, core);
+    if (result != pdPASS) {
+        Serial.println("Failed to create acquisition task");
+        taskHandle = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void AcquisitionTask::configure(unsigned long sampleIntervalMs, bool adaptiveResolution, uint8_t resolution) {
+    portENTER_CRITICAL(&configLock);
+    pendingConfig.sampleIntervalMs = sampleIntervalMs;
+    pendingConfig.adaptiveResolution = adaptiveResolution;
+    pendingConfig.resolution = resolution;
+    configPending = true;
+    portEXIT_CRITICAL(&configLock);
+}
+
+void AcquisitionTask::taskEntry(void* param) {
+    static_cast<AcquisitionTask*>(param)->run();
+}
+
+void AcquisitionTask::run() {
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;) {
+        applyPendingConfig();
+        sensorManager->update();
+
+        if (millis() - lastSampleTime >= sampleInterval) {
+            lastSampleTime = millis();
+            sample();
+
+            // Have the next conversion finish just before the next round
+            sensorManager->planReading(lastSampleTime + sampleInterval);
+        }
+
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(POLL_INTERVAL_MS));
+    }
+}
+
+void AcquisitionTask::applyPendingConfig() {
+    portENTER_CRITICAL(&configLock);
+    bool pending = configPending;
+    Config config = pendingConfig;
+    configPending = false;
+    portEXIT_CRITICAL(&configLock);
+
+    if (!pending) {
+        return;
+    }
+
+    // Touches the bus, so only done here and outside the critical section
+    sampleInterval = config.sampleIntervalMs;
+    sensorManager->setReadingInterval(sampleInterval);
+    sensorManager->setResolutionPolicy(config.adaptiveResolution, config.resolution);
+}
+
+void AcquisitionTask::sample() {
+    if (sensorManager->getSensorCount() == 0) {
+        Serial.println("Error reading temperature sensor!");
+        return;
+    }
+
+    tick++;
+    uint32_t epoch = (uint32_t)time(nullptr);
+    for (uint8_t sensor = 0; sensor < sensorManager->getSensorCount(); sensor++) {
+        if (!sensorManager->isSensorWorking(sensor)) {
+            continue;
+        }
+
+        Sample sample;
+        sample.epoch = epoch;
+        sample.tick = tick;
+        sample.temperature = sensorManager->getTemperature(sensor);
+        sample.sensorId = sensor;
+        sample.flags = anomalyDetector ? anomalyDetector->add(sensor, sample.temperature) : 0;
+
+        // A slow consumer only loses its own copy
+        if (!logQueue.push(sample)) {
+            droppedSamples++;
+        }
+        if (!broadcastQueue.push(sample)) {
+            droppedSamples++;
+        }
+    }
+}
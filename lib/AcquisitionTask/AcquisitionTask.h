@@ -0,0 +1,124 @@
+#ifndef ACQUISITION_TASK_H
+#define ACQUISITION_TASK_H
+
+#include <Arduino.h>
+#include <time.h>
+#include "SensorManager.h"
+#include "SpscRing.h"
+#include "AnomalyDetector.h"
+
+/**
+ * @brief One timestamped temperature reading handed from acquisition to consumers
+ */
+struct Sample {
+    uint32_t epoch;         // Unix time of the reading, small if NTP hasn't synced yet
+    uint32_t tick;          // Sampling round, shared by all sensors read together
+    float temperature;      // Celsius
+    uint8_t sensorId;       // Index of the sensor in SensorManager's ROM table
+    uint8_t flags;          // AnomalyFlag bits, 0 without a detector
+};
+
+/**
+ * @brief Runs sensor acquisition in its own FreeRTOS task
+ *
+ * The task drives SensorManager and, once per sampling interval, pushes one
+ * Sample per working sensor into two lock-free queues: one drained by the data
+ * logger and one by the WebSocket broadcaster. Sampling never waits on a
+ * consumer; if a queue is full the sample is dropped for that consumer only
+ * and counted.
+ *
+ * With an AnomalyDetector set, every sample passes through it on the way
+ * and carries its flags, so all consumers agree on which readings were
+ * anomalous.
+ *
+ * Once begin() has returned, the sensor bus belongs to the task. Settings
+ * changes must go through configure(), which hands them to the task.
+ */
+class AcquisitionTask {
+public:
+    static const size_t QUEUE_SIZE = 64;
+    typedef SpscRing<Sample, QUEUE_SIZE> SampleQueue;
+
+    /**
+     * @brief Construct a new Acquisition Task object
+     *
+     * @param sensorManager Initialized sensor manager to sample from
+     * @param sampleIntervalMs Time between sampling rounds in milliseconds
+     */
+    AcquisitionTask(SensorManager* sensorManager, unsigned long sampleIntervalMs);
+
+    /**
+     * @brief Start the acquisition task
+     *
+     * @param core Core to pin the task to
+     * @param priority FreeRTOS priority, above loop() by default
+     * @return true if the task was created
+     * @return false if the task could not be created
+     */
+    bool begin(BaseType_t core = 1, UBaseType_t priority = 2);
+
+    /**
+     * @brief Change the sampling interval and resolution policy
+     *
+     * Safe to call from any task; the change is applied by the acquisition
+     * task between conversions.
+     *
+     * @param sampleIntervalMs Time between sampling rounds in milliseconds
+     * @param adaptiveResolution true for adaptive resolution
+     * @param resolution Fixed resolution, or the maximum when adaptive
+     */
+    void configure(unsigned long sampleIntervalMs, bool adaptiveResolution, uint8_t resolution);
+
+    /**
+     * @brief Set the detector that flags each sample, before begin()
+     *
+     * @param detector Detector instance, or nullptr to leave samples unflagged
+     */
+    void setAnomalyDetector(AnomalyDetector* detector) { anomalyDetector = detector; }
+
+    /**
+     * @brief Queue drained by the data logger (single consumer)
+     */
+    SampleQueue& getLogQueue() { return logQueue; }
+
+    /**
+     * @brief Queue drained by the WebSocket broadcaster (single consumer)
+     */
+    SampleQueue& getBroadcastQueue() { return broadcastQueue; }
+
+    /**
+     * @brief Number of samples dropped because a consumer queue was full
+     */
+    uint32_t getDroppedSamples() const { return droppedSamples; }
+
+private:
+    static const uint32_t POLL_INTERVAL_MS = 5;
+    static const uint32_t STACK_SIZE = 4096;
+
+    struct Config {
+        unsigned long sampleIntervalMs;
+        bool adaptiveResolution;
+        uint8_t resolution;
+    };
+
+    SensorManager* sensorManager;
+    AnomalyDetector* anomalyDetector;
+    TaskHandle_t taskHandle;
+    SampleQueue logQueue;
+    SampleQueue broadcastQueue;
+    unsigned long sampleInterval;
+    unsigned long lastSampleTime;
+    uint32_t tick;
+    volatile uint32_t droppedSamples;
+
+    portMUX_TYPE configLock;
+    Config pendingConfig;
+    bool configPending;
+
+    static void taskEntry(void* param);
+    void run();
+    void applyPendingConfig();
+    void sample();
+};
+
+#endif // ACQUISITION_TASK_H
@@ -0,0 +1,186 @@
+#include "AlertEngine.h"
+
+namespace {
+    const char* const TYPE_NAMES[ALERT_TYPE_COUNT] = { "above", "below", "rate", "missing" };
+}
+
+AlertEngine::AlertEngine()
+    : ruleCount(0)
+    , startMs(millis())
+    , evaluations(0)
+    , evaluationMicros(0)
+    , maxEvaluationMicros(0)
+{
+    memset(sensors, 0, sizeof(sensors));
+    for (Sensor& sensor : sensors) {
+        sensor.seenMs = startMs;
+    }
+}
+
+void AlertEngine::setRules(const AlertRule* rules, uint8_t count) {
+    std::lock_guard<std::mutex> guard(lock);
+    ruleCount = count < MAX_RULES ? count : MAX_RULES;
+    memcpy(this->rules, rules, ruleCount * sizeof(AlertRule));
+    memset(states, 0, sizeof(states));
+    memset(holding, 0, sizeof(holding));
+}
+
+uint8_t AlertEngine::getRules(AlertRule* rules, State* states) const {
+    std::lock_guard<std::mutex> guard(lock);
+    memcpy(rules, this->rules, ruleCount * sizeof(AlertRule));
+    if (states) {
+        memcpy(states, this->states, ruleCount * sizeof(State));
+    }
+    return ruleCount;
+}
+
+uint8_t AlertEngine::getActiveCount() const {
+    std::lock_guard<std::mutex> guard(lock);
+    uint8_t active = 0;
+    for (uint8_t i = 0; i < ruleCount; i++) {
+        if (states[i].active) {
+            active++;
+        }
+    }
+    return active;
+}
+
+void AlertEngine::add(uint8_t sensorId, float temperature, uint32_t epoch) {
+    if (sensorId >= SensorManager::MAX_SENSORS) {
+        return;
+    }
+
+    unsigned long started = micros();
+    AlertEvent events[MAX_RULES];
+    uint8_t eventCount = 0;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        unsigned long now = millis();
+        Sensor& sensor = sensors[sensorId];
+        if (sensor.epoch == 0 || epoch > sensor.epoch) {
+            if (sensor.epoch != 0) {
+                float elapsed = epoch - sensor.epoch;
+                float slope = (temperature - sensor.temperature) * 60.0f / elapsed;
+                sensor.rate += (slope - sensor.rate) * elapsed / (RATE_SECONDS + elapsed);
+            }
+            sensor.temperature = temperature;
+            sensor.epoch = epoch;
+        }
+        sensor.seenMs = now;
+
+        for (uint8_t i = 0; i < ruleCount; i++) {
+            if (rules[i].sensorId != sensorId) {
+                continue;
+            }
+
+            float value = temperature;
+            if (rules[i].type == ALERT_RATE) {
+                value = sensor.rate;
+            } else if (rules[i].type == ALERT_MISSING) {
+                value = 0.0f;
+            }
+            if (evaluate(i, value, epoch, now, events[eventCount])) {
+                eventCount++;
+            }
+        }
+    }
+
+    // Only the evaluation is timed, sending the events is up to the callback
+    uint32_t elapsed = micros() - started;
+    evaluations++;
+    evaluationMicros += elapsed;
+    if (elapsed > maxEvaluationMicros) {
+        maxEvaluationMicros = elapsed;
+    }
+    notify(events, eventCount);
+}
+
+void AlertEngine::check() {
+    AlertEvent events[MAX_RULES];
+    uint8_t eventCount = 0;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        unsigned long now = millis();
+        uint32_t epoch = (uint32_t)time(nullptr);
+        for (uint8_t i = 0; i < ruleCount; i++) {
+            if (rules[i].type != ALERT_MISSING || rules[i].sensorId >= SensorManager::MAX_SENSORS) {
+                continue;
+            }
+
+            float silent = (now - sensors[rules[i].sensorId].seenMs) / 1000.0f;
+            if (evaluate(i, silent, epoch, now, events[eventCount])) {
+                eventCount++;
+            }
+        }
+    }
+    notify(events, eventCount);
+}
+
+void AlertEngine::setCallback(std::function<void(const AlertEvent&)> callback) {
+    this->callback = callback;
+}
+
+bool AlertEngine::evaluate(uint8_t index, float value, uint32_t epoch, unsigned long now, AlertEvent& event) {
+    const AlertRule& rule = rules[index];
+    State& state = states[index];
+    state.value = value;
+
+    // Falling rules trip below the threshold and recover above it, all others the other way round
+    bool falling = rule.type == ALERT_BELOW || (rule.type == ALERT_RATE && rule.threshold < 0.0f);
+    bool tripped = falling ? value < rule.threshold : value > rule.threshold;
+    bool recovered = falling ? value >= rule.threshold + rule.hysteresis
+                             : value <= rule.threshold - rule.hysteresis;
+
+    if (!state.active) {
+        if (!tripped) {
+            holding[index] = false;
+            return false;
+        }
+        if (!holding[index]) {
+            holding[index] = true;
+            holdStartMs[index] = now;
+        }
+        if (now - holdStartMs[index] < rule.holdSeconds * 1000UL) {
+            return false;
+        }
+        holding[index] = false;
+        state.active = true;
+        state.raisedEpoch = epoch;
+    } else if (recovered) {
+        state.active = false;
+    } else {
+        return false;
+    }
+
+    event.rule = index;
+    event.type = rule.type;
+    event.sensorId = rule.sensorId;
+    event.active = state.active;
+    event.value = value;
+    event.threshold = rule.threshold;
+    event.epoch = epoch;
+    return true;
+}
+
+void AlertEngine::notify(const AlertEvent* events, uint8_t count) {
+    if (!callback) {
+        return;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        callback(events[i]);
+    }
+}
+
+const char* AlertEngine::getTypeName(AlertType type) {
+    return type < ALERT_TYPE_COUNT ? TYPE_NAMES[type] : "unknown";
+}
+
+bool AlertEngine::parseType(const char* name, AlertType& type) {
+    for (uint8_t i = 0; i < ALERT_TYPE_COUNT; i++) {
+        if (strcmp(name, TYPE_NAMES[i]) == 0) {
+            type = (AlertType)i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,145 @@
+#ifndef ALERT_ENGINE_H
+#define ALERT_ENGINE_H
+
+#include <Arduino.h>
+#include <functional>
+#include <mutex>
+#include "SensorManager.h"
+
+enum AlertType : uint8_t {
+    ALERT_ABOVE,    // Temperature above threshold °C
+    ALERT_BELOW,    // Temperature below threshold °C
+    ALERT_RATE,     // Rising faster than threshold °C/min, or falling faster if negative
+    ALERT_MISSING,  // No reading for threshold seconds
+    ALERT_TYPE_COUNT
+};
+
+/**
+ * @brief One alert condition on one sensor
+ */
+struct AlertRule {
+    AlertType type;
+    uint8_t sensorId;
+    float threshold;
+    float hysteresis;       // How far back past the threshold before the alert clears
+    uint32_t holdSeconds;   // How long the condition must last before the alert is raised
+};
+
+/**
+ * @brief An alert being raised or cleared
+ */
+struct AlertEvent {
+    uint8_t rule;           // Index of the rule
+    AlertType type;
+    uint8_t sensorId;
+    bool active;            // true when raised, false when cleared
+    float value;            // Temperature, rate in °C/min or seconds without a reading
+    float threshold;
+    uint32_t epoch;         // Time of the reading that raised or cleared the alert
+};
+
+/**
+ * @brief Evaluates alert rules against every reading
+ *
+ * add() is called right after each sample and only looks at the rules, so
+ * its cost is bounded by MAX_RULES comparisons. Rates are kept per sensor as
+ * an exponentially smoothed slope with a RATE_SECONDS time constant, which
+ * averages out the sensor's quantization steps. Missing sensors are noticed
+ * by check(), which is cheap enough to run on every loop().
+ *
+ * Hold times and missing timeouts run on millis(), so a clock step when NTP
+ * syncs doesn't raise anything. Rules are replaced from the network task
+ * while loop() evaluates them, so access is locked; the callback runs after
+ * the lock is released.
+ */
+class AlertEngine {
+public:
+    static const uint8_t MAX_RULES = 8;
+    static const uint32_t RATE_SECONDS = 60;
+
+    struct State {
+        bool active;
+        float value;            // Last value the rule was evaluated on
+        uint32_t raisedEpoch;   // Time the alert was raised, if active
+    };
+
+    AlertEngine();
+
+    /**
+     * @brief Replace the rules, clearing all alerts without events
+     *
+     * @param rules Rules to evaluate
+     * @param count Number of rules, at most MAX_RULES are used
+     */
+    void setRules(const AlertRule* rules, uint8_t count);
+
+    /**
+     * @brief Copy out the rules and their states
+     *
+     * @param rules Receives up to MAX_RULES rules
+     * @param states Receives the state of each rule, or nullptr
+     * @return uint8_t Number of rules
+     */
+    uint8_t getRules(AlertRule* rules, State* states = nullptr) const;
+
+    /**
+     * @brief Number of alerts currently raised
+     */
+    uint8_t getActiveCount() const;
+
+    /**
+     * @brief Evaluate the rules of a sensor against a new reading
+     *
+     * @param sensorId Index of the sensor that produced the reading
+     * @param temperature Temperature in Celsius
+     * @param epoch Unix time of the reading
+     */
+    void add(uint8_t sensorId, float temperature, uint32_t epoch);
+
+    /**
+     * @brief Raise missing-sensor alerts whose timeout has passed
+     */
+    void check();
+
+    /**
+     * @brief Set the function called for every alert raised or cleared
+     */
+    void setCallback(std::function<void(const AlertEvent&)> callback);
+
+    /**
+     * @brief Time spent in add(), to check evaluation never holds up acquisition
+     */
+    uint32_t getEvaluations() const { return evaluations; }
+    uint32_t getMeanEvaluationMicros() const { return evaluations ? evaluationMicros / evaluations : 0; }
+    uint32_t getMaxEvaluationMicros() const { return maxEvaluationMicros; }
+
+    static const char* getTypeName(AlertType type);
+    static bool parseType(const char* name, AlertType& type);
+
+private:
+    struct Sensor {
+        float temperature;
+        float rate;             // Smoothed slope in °C/min
+        uint32_t epoch;         // Unix time of the last reading, 0 before the first
+        unsigned long seenMs;   // millis() of the last reading
+    };
+
+    AlertRule rules[MAX_RULES];
+    State states[MAX_RULES];
+    bool holding[MAX_RULES];                // Condition met, waiting out the hold time
+    unsigned long holdStartMs[MAX_RULES];   // millis() the condition was first met
+    uint8_t ruleCount;
+    Sensor sensors[SensorManager::MAX_SENSORS];
+    unsigned long startMs;
+
+    std::function<void(const AlertEvent&)> callback;
+    volatile uint32_t evaluations;
+    volatile uint32_t evaluationMicros;
+    volatile uint32_t maxEvaluationMicros;
+    mutable std::mutex lock;
+
+    bool evaluate(uint8_t rule, float value, uint32_t epoch, unsigned long now, AlertEvent& event);
+    void notify(const AlertEvent* events, uint8_t count);
+};
+
+#endif // ALERT_ENGINE_H
@@ -0,0 +1,125 @@
+#include "AnomalyDetector.h"
+
+namespace {
+    uint32_t packConfig(uint16_t span, float threshold) {
+        // A span of at least 1 keeps a packed config from reading as "none"
+        uint32_t centiThreshold = constrain(lroundf(threshold * 100.0f), 0L, (long)UINT16_MAX);
+        return (uint32_t)max(span, (uint16_t)1) << 16 | centiThreshold;
+    }
+}
+
+AnomalyDetector::AnomalyDetector(uint16_t span, float threshold) : pendingConfig(0) {
+    for (Published& sensor : published) {
+        sensor.version.store(0, std::memory_order_relaxed);
+    }
+    apply(packConfig(span, threshold));
+}
+
+void AnomalyDetector::configure(uint16_t span, float threshold) {
+    pendingConfig.store(packConfig(span, threshold), std::memory_order_release);
+}
+
+void AnomalyDetector::apply(uint32_t config) {
+    span = config >> 16;
+    threshold = (config & 0xFFFF) / 100.0f;
+    alpha = 2.0f / (span + 1);
+    fastAlpha = min(FAST_RATIO * alpha, 1.0f);
+    // An EWMA of independent readings varies by sd * sqrt(a / (2 - a))
+    fastError = sqrtf(fastAlpha / (2.0f - fastAlpha));
+    memset(sensors, 0, sizeof(sensors));
+    for (uint8_t i = 0; i < SensorManager::MAX_SENSORS; i++) {
+        publish(i);
+    }
+}
+
+uint8_t AnomalyDetector::add(uint8_t sensorId, float temperature) {
+    if (sensorId >= SensorManager::MAX_SENSORS) {
+        return 0;
+    }
+
+    // Only swap when there is something to take, a plain load is cheaper
+    if (pendingConfig.load(std::memory_order_relaxed) != 0) {
+        apply(pendingConfig.exchange(0, std::memory_order_acquire));
+    }
+
+    Baseline& sensor = sensors[sensorId];
+    if (sensor.count++ == 0) {
+        sensor.mean = temperature;
+        sensor.fastMean = temperature;
+        sensor.variance = 0.0f;
+        sensor.gapVariance = 0.0f;
+        publish(sensorId);
+        return 0;
+    }
+
+    float stdDev = fmaxf(sqrtf(sensor.variance), MIN_STD_DEV);
+    float limit = threshold * stdDev;
+    float deviation = temperature - sensor.fastMean;
+
+    uint8_t flags = 0;
+    bool warm = sensor.count > span;
+    if (warm && fabsf(deviation) > limit) {
+        flags |= ANOMALY_OUTLIER;
+        sensor.outliers++;
+    }
+
+    // Clamped so a single spike can't drag the means along
+    float clamped = constrain(deviation, -limit, limit);
+    sensor.fastMean += fastAlpha * clamped;
+    sensor.variance = (1.0f - fastAlpha) * (sensor.variance + fastAlpha * clamped * clamped);
+    sensor.mean += alpha * (sensor.fastMean - sensor.mean);
+
+    // The gap between the means is judged against how far apart they usually
+    // are, so a regular daily cycle isn't a shift while a drift out of it is
+    float gap = sensor.fastMean - sensor.mean;
+    float gapLimit = threshold * fmaxf(sqrtf(sensor.gapVariance), stdDev * fastError);
+    if (warm && fabsf(gap) > gapLimit) {
+        flags |= ANOMALY_SHIFT;
+        sensor.shifts++;
+    }
+    float clampedGap = constrain(gap, -gapLimit, gapLimit);
+    sensor.gapVariance = (1.0f - alpha) * (sensor.gapVariance + alpha * clampedGap * clampedGap);
+    publish(sensorId);
+    return flags;
+}
+
+void AnomalyDetector::publish(uint8_t sensorId) {
+    const Baseline& sensor = sensors[sensorId];
+    Published& target = published[sensorId];
+
+    // Odd while the fields change; the fence keeps the stores below after it
+    uint32_t version = target.version.load(std::memory_order_relaxed);
+    target.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    target.mean.store(sensor.mean, std::memory_order_relaxed);
+    target.fastMean.store(sensor.fastMean, std::memory_order_relaxed);
+    target.stdDev.store(fmaxf(sqrtf(sensor.variance), MIN_STD_DEV), std::memory_order_relaxed);
+    target.count.store(sensor.count, std::memory_order_relaxed);
+    target.outliers.store(sensor.outliers, std::memory_order_relaxed);
+    target.shifts.store(sensor.shifts, std::memory_order_relaxed);
+    target.version.store(version + 2, std::memory_order_release);
+}
+
+bool AnomalyDetector::getState(uint8_t sensorId, State& state) const {
+    if (sensorId >= SensorManager::MAX_SENSORS) {
+        return false;
+    }
+
+    const Published& source = published[sensorId];
+    for (;;) {
+        uint32_t version = source.version.load(std::memory_order_acquire);
+        state.mean = source.mean.load(std::memory_order_relaxed);
+        state.fastMean = source.fastMean.load(std::memory_order_relaxed);
+        state.stdDev = source.stdDev.load(std::memory_order_relaxed);
+        state.count = source.count.load(std::memory_order_relaxed);
+        state.outliers = source.outliers.load(std::memory_order_relaxed);
+        state.shifts = source.shifts.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (version % 2 == 0 && source.version.load(std::memory_order_relaxed) == version) {
+            return true;
+        }
+        // The writer may be a lower priority task preempted mid-update on
+        // this core, so give it time to finish rather than spinning
+        delay(1);
+    }
+}
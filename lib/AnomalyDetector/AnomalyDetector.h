@@ -0,0 +1,130 @@
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "SensorManager.h"
+
+/**
+ * @brief Bits set in a reading's flags by AnomalyDetector
+ */
+enum AnomalyFlag : uint8_t {
+    ANOMALY_OUTLIER = 0x01,     // Reading far from the sensor's recent mean
+    ANOMALY_SHIFT = 0x02        // Recent readings as a group moved away from the baseline
+};
+
+/**
+ * @brief Flags readings that don't fit a sensor's recent behaviour
+ *
+ * Keeps two exponentially weighted means per sensor: a fast one with a
+ * weight of FAST_RATIO * 2 / (span + 1) per reading, and a slow one that
+ * follows the fast one over roughly `span` readings. A reading more than
+ * `threshold` standard deviations from the fast mean is an outlier, where
+ * the deviation is the short-term noise around the fast mean. The gap
+ * between the two means has its own weighted variance; a gap beyond
+ * `threshold` of its usual size is a shift. That catches steps and drifts
+ * too slow to flag any one reading, without flagging a daily cycle the
+ * baseline has already seen.
+ *
+ * Deviations are clamped to the threshold before they update the means and
+ * variances, so one spike barely moves the baseline while a lasting step
+ * still raises the variance within a few readings and is followed. The
+ * standard deviation never drops below MIN_STD_DEV, or the sensor's 1/16 °C
+ * steps would look like outliers on a flat signal. Nothing is flagged until
+ * `span` readings have been seen.
+ *
+ * Each update is O(1) and never blocks. Readings are added from the
+ * acquisition task only; after each one the sensor's State is published
+ * under a sequence counter, so getState() on the network task retries
+ * instead of taking a lock the acquisition task would have to wait for. New
+ * parameters from configure() are handed over in one atomic word and
+ * applied by the next add().
+ */
+class AnomalyDetector {
+public:
+    static constexpr float MIN_STD_DEV = 0.05f;
+    static constexpr float FAST_RATIO = 8.0f;
+
+    struct State {
+        float mean;         // Slow mean in Celsius
+        float fastMean;
+        float stdDev;       // Short-term noise around the fast mean, at least MIN_STD_DEV
+        uint32_t count;     // Readings seen
+        uint32_t outliers;  // Readings flagged ANOMALY_OUTLIER
+        uint32_t shifts;    // Readings flagged ANOMALY_SHIFT
+    };
+
+    /**
+     * @brief Construct a new Anomaly Detector object
+     *
+     * @param span Readings the baseline averages over, roughly
+     * @param threshold Standard deviations that make a reading anomalous
+     */
+    AnomalyDetector(uint16_t span = 720, float threshold = 4.0f);
+
+    /**
+     * @brief Change the parameters, restarting every sensor's baseline
+     *
+     * Takes effect with the next reading. The threshold is kept to 1/100.
+     */
+    void configure(uint16_t span, float threshold);
+
+    /**
+     * @brief Update a sensor's baseline with a reading
+     *
+     * Call from one task only.
+     *
+     * @param sensorId Index of the sensor that produced the reading
+     * @param temperature Temperature in Celsius
+     * @return uint8_t AnomalyFlag bits for the reading, 0 if it fits
+     */
+    uint8_t add(uint8_t sensorId, float temperature);
+
+    /**
+     * @brief Copy out the baseline of one sensor as of its last reading
+     *
+     * Safe to call from any task while add() runs.
+     *
+     * @return false if the sensor id is out of range
+     */
+    bool getState(uint8_t sensorId, State& state) const;
+
+private:
+    struct Baseline {
+        float mean;
+        float variance;     // Of readings around the fast mean
+        float fastMean;
+        float gapVariance;  // Of the fast mean around the slow one
+        uint32_t count;
+        uint32_t outliers;
+        uint32_t shifts;
+    };
+
+    // A State as seen by other tasks. The version is odd while add() is
+    // writing it; the fields are atomic only so a torn read is well defined.
+    struct Published {
+        std::atomic<uint32_t> version;
+        std::atomic<float> mean;
+        std::atomic<float> fastMean;
+        std::atomic<float> stdDev;
+        std::atomic<uint32_t> count;
+        std::atomic<uint32_t> outliers;
+        std::atomic<uint32_t> shifts;
+    };
+
+    // Owned by the task calling add()
+    uint16_t span;
+    float threshold;
+    float alpha;        // Weight of an update to the slow mean and gap variance
+    float fastAlpha;    // Weight of a reading in the fast mean and noise variance
+    float fastError;    // Standard error of the fast mean per unit of standard deviation
+    Baseline sensors[SensorManager::MAX_SENSORS];
+
+    Published published[SensorManager::MAX_SENSORS];
+    std::atomic<uint32_t> pendingConfig;  // Span << 16 | threshold * 100, 0 if none
+
+    void apply(uint32_t config);
+    void publish(uint8_t sensorId);
+};
+
+#endif // ANOMALY_DETECTOR_H
@@ -0,0 +1,152 @@
+#include "BlockArchive.h"
+
+BlockArchive::BlockArchive(fs::FS& fs, const char* path, uint32_t capacity)
+    : blocks(fs, path, capacity, sizeof(TemperatureBlock))
+    , storedSensors(0)
+    , storedReadings(0)
+    , storedBlocks(0)
+{
+    for (uint8_t sensor = 0; sensor < MAX_SENSORS; sensor++) {
+        open[sensor].reset(sensor);
+    }
+}
+
+bool BlockArchive::begin() {
+    if (!blocks.begin()) {
+        return false;
+    }
+
+    // Range queries need to know which sensors to wait for past their end
+    storedSensors = 0;
+    RingLog::Reader reader = blocks.openReader();
+    TemperatureBlock block;
+    while (reader.next(&block)) {
+        if (block.sensorId < MAX_SENSORS) {
+            storedSensors |= 1 << block.sensorId;
+        }
+    }
+    return true;
+}
+
+void BlockArchive::resume(const RingLog& log) {
+    // Nothing older than the raw log can be re-encoded, so the walk back
+    // through the blocks can stop there
+    RingLog::Reader oldest = log.openReader();
+    LogRecord first;
+    if (!oldest.next(&first)) {
+        return;
+    }
+    uint32_t rawOldest = first.epoch;
+
+    // Find the newest archived reading of each sensor. A sensor that fills
+    // its blocks slowly may have its last one far behind those of the others.
+    uint32_t archived[MAX_SENSORS] = {};
+    uint8_t seen = 0;
+    RingLog::Reader reader = blocks.openReader();
+    TemperatureBlock block;
+    for (uint32_t index = reader.size(); index > 0 && seen != storedSensors; index--) {
+        if (!reader.seek(index - 1) || !reader.next(&block)) {
+            break;
+        }
+        if (block.sealedEpoch <= rawOldest) {
+            break;
+        }
+        if (block.sensorId >= MAX_SENSORS || (seen & (1 << block.sensorId))) {
+            continue;
+        }
+        BlockDecoder decoder(block);
+        uint32_t epoch;
+        int16_t value;
+        while (decoder.next(epoch, value)) {
+            archived[block.sensorId] = epoch;
+        }
+        seen |= 1 << block.sensorId;
+    }
+
+    // Sensors not found have nothing archived that the raw log still holds
+    uint32_t since = UINT32_MAX;
+    for (uint8_t sensor = 0; sensor < MAX_SENSORS; sensor++) {
+        since = min(since, archived[sensor]);
+    }
+
+    uint32_t count;
+    RingLog::Reader raw = log.openRangeReader(since + 1, 0, 0, count);
+    LogRecord batch[32];
+    size_t n;
+    uint32_t resumed = 0;
+    while ((n = raw.read(batch, min((uint32_t)32, raw.remaining()))) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            const LogRecord& record = batch[i];
+            if (record.sensorId < MAX_SENSORS && record.epoch > archived[record.sensorId]) {
+                add(record);
+                resumed++;
+            }
+        }
+    }
+    if (resumed > 0) {
+        Serial.printf("Archived %lu readings from the raw log\n", (unsigned long)resumed);
+    }
+}
+
+bool BlockArchive::add(const LogRecord& record) {
+    if (record.sensorId >= MAX_SENSORS) {
+        return true;
+    }
+
+    BlockEncoder& encoder = open[record.sensorId];
+    int16_t value = BlockEncoder::toSixteenths(record.centiCelsius);
+    if (encoder.add(record.epoch, value)) {
+        return true;
+    }
+
+    // Block is full: store it and start the next one with this reading
+    bool stored = store(encoder);
+    encoder.reset(record.sensorId);
+    encoder.add(record.epoch, value);
+    return stored;
+}
+
+bool BlockArchive::store(BlockEncoder& encoder) {
+    if (!blocks.append(&encoder.getBlock())) {
+        Serial.println("Failed to append archive block");
+        return false;
+    }
+    storedSensors |= 1 << encoder.getBlock().sensorId;
+    storedReadings += encoder.getBlock().count;
+    storedBlocks++;
+    return true;
+}
+
+RingLog::Reader BlockArchive::openRangeReader(uint32_t from, uint32_t to, uint32_t& count) const {
+    RingLog::Reader reader = blocks.openReader();
+    count = 0;
+    if (!reader.isValid()) {
+        return reader;
+    }
+
+    // Blocks are keyed by the epoch after their last reading, so the first
+    // block that can hold `from` is found directly. Past `to`, the first
+    // block of each sensor can still start before it, and a slowly filling
+    // sensor's may come after many blocks of the others.
+    uint32_t first = from > 0 ? blocks.lowerBound(reader, from) : 0;
+    uint32_t end = reader.size();
+    if (to > 0) {
+        end = blocks.lowerBound(reader, to + 1);
+        uint8_t waiting = storedSensors;
+        TemperatureBlock block;
+        reader.seek(end);
+        for (uint32_t index = end; waiting != 0 && reader.next(&block); index++) {
+            if (block.sensorId < MAX_SENSORS && (waiting & (1 << block.sensorId))) {
+                waiting &= ~(1 << block.sensorId);
+                end = index + 1;
+            }
+        }
+    }
+    if (first > end) {
+        first = end;
+    }
+
+    count = end - first;
+    reader.seek(first);
+    return reader;
+}
@@ -0,0 +1,92 @@
+#ifndef BLOCK_ARCHIVE_H
+#define BLOCK_ARCHIVE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "BlockCodec.h"
+#include "RingLog.h"
+
+/**
+ * @brief Long-retention copy of the raw log in compressed blocks
+ *
+ * Every sensor fills its own open TemperatureBlock in RAM; a block is
+ * appended to a RingLog of blocks once the next reading doesn't fit. At about
+ * two bytes per reading instead of eight, the archive keeps several times the
+ * history of the raw log in the same space. The readings of the open blocks
+ * are still in the raw log and are re-encoded from there after a reboot.
+ */
+class BlockArchive {
+public:
+    static const uint8_t MAX_SENSORS = 8;
+
+    /**
+     * @brief Construct a new Block Archive object
+     *
+     * @param fs Filesystem holding the archive file
+     * @param path Path of the archive file
+     * @param capacity Number of blocks to keep
+     */
+    BlockArchive(fs::FS& fs, const char* path, uint32_t capacity);
+
+    /**
+     * @brief Open the archive file, creating it if needed
+     *
+     * @return true if the archive is ready
+     */
+    bool begin();
+
+    /**
+     * @brief Re-encode the raw readings that didn't make it into a stored block
+     *
+     * Call after begin() with the raw log the archive mirrors. Walks back
+     * through the stored blocks until it has found the newest block of every
+     * sensor, or reached blocks older than anything in the raw log.
+     *
+     * @param log Raw log of LogRecords
+     */
+    void resume(const RingLog& log);
+
+    /**
+     * @brief Add a reading, storing its sensor's block if it is full
+     *
+     * Readings of sensors beyond MAX_SENSORS are ignored.
+     *
+     * @return false if a full block could not be written
+     */
+    bool add(const LogRecord& record);
+
+    /**
+     * @brief Open a reader over the stored blocks that may hold readings in a time range
+     *
+     * Blocks past the range are included up to the first one of each sensor
+     * keyed after `to`, however many blocks of faster filling sensors came
+     * before it. Callers filter the decoded readings by time.
+     *
+     * @param from Oldest timestamp wanted, 0 for no lower bound
+     * @param to Newest timestamp wanted, 0 for no upper bound
+     * @param count Receives the number of blocks left to read
+     * @return RingLog::Reader Reader returning TemperatureBlocks
+     */
+    RingLog::Reader openRangeReader(uint32_t from, uint32_t to, uint32_t& count) const;
+
+    uint32_t getBlockCount() const { return blocks.size(); }
+    uint32_t getCapacity() const { return blocks.getRetention(); }
+
+    /**
+     * @brief Readings in the blocks stored since boot, for the bytes-per-reading figure
+     */
+    uint32_t getStoredReadings() const { return storedReadings; }
+    uint32_t getStoredBlocks() const { return storedBlocks; }
+    uint32_t getBytesWritten() const { return blocks.getBytesWritten(); }
+
+private:
+    RingLog blocks;
+    BlockEncoder open[MAX_SENSORS];
+    uint8_t storedSensors;      // Bit per sensor that has blocks in the file
+    uint32_t storedReadings;
+    uint32_t storedBlocks;
+
+    bool store(BlockEncoder& encoder);
+};
+
+#endif // BLOCK_ARCHIVE_H
@@ -0,0 +1,130 @@
+#include "BlockCodec.h"
+
+namespace {
+    uint64_t zigZag(int64_t value) {
+        return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+    }
+
+    int64_t unZigZag(uint64_t value) {
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+
+    size_t putVarint(uint8_t* out, uint64_t value) {
+        size_t n = 0;
+        while (value >= 0x80) {
+            out[n++] = (uint8_t)value | 0x80;
+            value >>= 7;
+        }
+        out[n++] = (uint8_t)value;
+        return n;
+    }
+
+    bool getVarint(const uint8_t* in, size_t length, size_t& position, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && position < length; shift += 7) {
+            uint8_t byte = in[position++];
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+BlockEncoder::BlockEncoder() {
+    reset(0);
+}
+
+void BlockEncoder::reset(uint8_t sensorId) {
+    memset(&block, 0, sizeof(block));
+    block.sensorId = sensorId;
+    used = 0;
+    lastEpoch = 0;
+    lastDelta = 0;
+    lastValue = 0;
+}
+
+bool BlockEncoder::add(uint32_t epoch, int16_t sixteenths) {
+    if (block.count == 0) {
+        block.firstEpoch = epoch;
+        block.firstValue = sixteenths;
+        block.count = 1;
+        lastEpoch = epoch;
+        lastDelta = 0;
+        lastValue = sixteenths;
+        return true;
+    }
+
+    // Encode into scratch first so a reading that doesn't fit leaves the block untouched
+    int64_t delta = (int64_t)epoch - lastEpoch;
+    uint8_t scratch[20];
+    size_t n = putVarint(scratch, zigZag(block.count == 1 ? delta : delta - lastDelta));
+    n += putVarint(scratch + n, zigZag((int32_t)sixteenths - lastValue));
+
+    if (block.count == UINT8_MAX || used + n > TemperatureBlock::PAYLOAD_SIZE) {
+        block.sealedEpoch = epoch;
+        return false;
+    }
+
+    memcpy(block.payload + used, scratch, n);
+    used += n;
+    block.count++;
+    lastEpoch = epoch;
+    lastDelta = delta;
+    lastValue = sixteenths;
+    return true;
+}
+
+int16_t BlockEncoder::toSixteenths(int16_t centiCelsius) {
+    int32_t scaled = (int32_t)centiCelsius * 16;
+    return (int16_t)((scaled >= 0 ? scaled + 50 : scaled - 50) / 100);
+}
+
+int16_t BlockEncoder::toCentiCelsius(int16_t sixteenths) {
+    int32_t scaled = (int32_t)sixteenths * 100;
+    return (int16_t)((scaled >= 0 ? scaled + 8 : scaled - 8) / 16);
+}
+
+BlockDecoder::BlockDecoder() : position(0), decoded(0), lastEpoch(0), lastDelta(0), lastValue(0) {
+    memset(&block, 0, sizeof(block));
+}
+
+BlockDecoder::BlockDecoder(const TemperatureBlock& block)
+    : block(block)
+    , position(0)
+    , decoded(0)
+    , lastEpoch(0)
+    , lastDelta(0)
+    , lastValue(0)
+{
+}
+
+bool BlockDecoder::next(uint32_t& epoch, int16_t& sixteenths) {
+    if (decoded >= block.count) {
+        return false;
+    }
+
+    if (decoded == 0) {
+        lastEpoch = block.firstEpoch;
+        lastValue = block.firstValue;
+    } else {
+        uint64_t time;
+        uint64_t value;
+        if (!getVarint(block.payload, TemperatureBlock::PAYLOAD_SIZE, position, time) ||
+            !getVarint(block.payload, TemperatureBlock::PAYLOAD_SIZE, position, value)) {
+            decoded = block.count;
+            return false;
+        }
+
+        int64_t delta = decoded == 1 ? unZigZag(time) : lastDelta + unZigZag(time);
+        lastEpoch = (uint32_t)(lastEpoch + delta);
+        lastDelta = delta;
+        lastValue = (int16_t)(lastValue + unZigZag(value));
+    }
+
+    decoded++;
+    epoch = lastEpoch;
+    sixteenths = lastValue;
+    return true;
+}
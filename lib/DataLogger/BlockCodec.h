@@ -0,0 +1,111 @@
+#ifndef BLOCK_CODEC_H
+#define BLOCK_CODEC_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Fixed-size block of compressed readings of one sensor
+ *
+ * A block can be decoded on its own. The header holds the first reading;
+ * every later one is a pair of zig-zag varints:
+ *   - the time since the previous reading for the second one, the change in
+ *     that time (delta-of-delta) for the rest
+ *   - the change of the DS18B20 raw value in 1/16 °C
+ * A reading costs two bytes while the interval drifts by under a minute and
+ * the temperature moves by under 4 °C between readings.
+ *
+ * The block starts with the epoch of the reading that did not fit into it,
+ * which is later than every reading inside and grows from block to block, so
+ * blocks can be kept in a RingLog and searched by time.
+ */
+struct TemperatureBlock {
+    static const size_t SIZE = 128;
+    static const size_t HEADER_SIZE = 12;
+    static const size_t PAYLOAD_SIZE = SIZE - HEADER_SIZE;
+
+    uint32_t sealedEpoch;   // Epoch of the first reading after the block
+    uint32_t firstEpoch;
+    int16_t firstValue;     // First reading in 1/16 °C
+    uint8_t count;
+    uint8_t sensorId;
+    uint8_t payload[PAYLOAD_SIZE];
+};
+
+/**
+ * @brief Appends readings to a TemperatureBlock
+ */
+class BlockEncoder {
+public:
+    BlockEncoder();
+
+    /**
+     * @brief Start an empty block
+     *
+     * @param sensorId Sensor the block's readings come from
+     */
+    void reset(uint8_t sensorId);
+
+    /**
+     * @brief Add the next reading
+     *
+     * @param epoch Unix timestamp of the reading
+     * @param sixteenths Temperature in 1/16 °C
+     * @return true if the reading was added
+     * @return false if it doesn't fit; the block is then complete and
+     *         sealed with this reading's epoch
+     */
+    bool add(uint32_t epoch, int16_t sixteenths);
+
+    bool isEmpty() const { return block.count == 0; }
+    const TemperatureBlock& getBlock() const { return block; }
+
+    /**
+     * @brief Bytes of payload in use
+     */
+    size_t getUsedBytes() const { return used; }
+
+    /**
+     * @brief Convert 1/100 °C to the sensor's 1/16 °C steps
+     */
+    static int16_t toSixteenths(int16_t centiCelsius);
+
+    /**
+     * @brief Convert 1/16 °C to 1/100 °C, the inverse of toSixteenths() for sensor values
+     */
+    static int16_t toCentiCelsius(int16_t sixteenths);
+
+private:
+    TemperatureBlock block;
+    size_t used;
+    uint32_t lastEpoch;
+    int64_t lastDelta;
+    int16_t lastValue;
+};
+
+/**
+ * @brief Reads the readings back out of a TemperatureBlock
+ */
+class BlockDecoder {
+public:
+    BlockDecoder();
+    explicit BlockDecoder(const TemperatureBlock& block);
+
+    /**
+     * @brief Decode the next reading
+     *
+     * @return false once all readings were returned or the block is corrupt
+     */
+    bool next(uint32_t& epoch, int16_t& sixteenths);
+
+    uint8_t getSensorId() const { return block.sensorId; }
+
+private:
+    TemperatureBlock block;
+    size_t position;
+    uint8_t decoded;
+    uint32_t lastEpoch;
+    int64_t lastDelta;
+    int16_t lastValue;
+};
+
+#endif // BLOCK_CODEC_H
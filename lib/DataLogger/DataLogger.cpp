@@ -1,10 +1,27 @@
 #include "DataLogger.h"
 
-DataLogger::DataLogger(const char* logFileName, unsigned long loggingIntervalSeconds)
+DataLogger::DataLogger(const char* logFileName, unsigned long loggingIntervalSeconds, uint32_t maxEntries,
+                       uint32_t cacheEntries)
     : filename(logFileName)
     , intervalSeconds(loggingIntervalSeconds)
     , lastLogTime(0)
     , lastTemperature(0.0f)
+    , lastResizeMicros(0)
+    , ringLog(SPIFFS, logFileName, maxEntries)
+    , rollups(SPIFFS)
+    , archive(SPIFFS, "/temperature_archive.bin", ARCHIVE_BLOCKS)
+    , cache(std::make_shared<SampleCache>(cacheEntries))
+    , pendingSince(0)
+    , commitRecords(16)
+    , commitMillis(300000)
+    , samplesLogged(0)
+    , flushCount(0)
+    , writeThroughBytes(0)
+    , compression(false)
+    , toleranceCelsius(0.0f)
+    , heartbeatSeconds(0)
+    , orderedCount(0)
+    , samplesOffered(0)
 {
 }
 
@@ -14,124 +31,315 @@ bool DataLogger::begin() {
         return false;
     }
 
-    // Check if log file exists, if not create it
-    if (!SPIFFS.exists(filename)) {
-        return createLogFile();
+    if (!ringLog.begin()) {
+        return false;
+    }
+
+    if (!rollups.begin()) {
+        Serial.println("Failed to open rollup files");
+    }
+
+    if (buffer.restore()) {
+        replayBuffer();
+    } else {
+        buffer.clear(ringLog.getSequence());
+    }
+
+    if (archive.begin()) {
+        archive.resume(ringLog);
+    } else {
+        Serial.println("Failed to open archive file");
+    }
+
+    // Resume from the newest stored reading so a reboot doesn't force an early log
+    LogRecord last;
+    if (ringLog.readLast(&last)) {
+        lastLogTime = last.epoch;
+        lastTemperature = last.centiCelsius / 100.0f;
+    }
+    if ((time_t)buffer.getLastLogTime() > lastLogTime) {
+        lastLogTime = buffer.getLastLogTime();
     }
 
+    warmCache();
     return true;
 }
 
-bool DataLogger::createLogFile() {
-    File file = SPIFFS.open(filename, "w");
-    if (!file) {
-        Serial.println("Failed to create log file");
+bool DataLogger::logTemperature(float temperature, uint8_t sensorId, time_t timestamp, uint8_t flags) {
+    time_t now;
+    time(&now);  // Get current timestamp
+    if (timestamp == 0) {
+        timestamp = now;
+    }
+    
+    // The buffer only fills up if earlier batches failed to write; fail
+    // before the rollups see the reading, so a retry doesn't count it twice
+    if (buffer.size() == MAX_COMMIT_RECORDS && !flush()) {
         return false;
     }
 
-    // Create initial JSON structure with an empty array
-    String initialJson = "{\"readings\":[]}";
-    if (file.print(initialJson) == 0) {
-        Serial.println("Failed to write initial JSON structure");
-        file.close();
+    if (sensorId == 0) {
+        lastTemperature = temperature;
+    }
+    // Flagged readings logged between intervals don't move the schedule
+    if (flags == 0 || shouldLog()) {
+        lastLogTime = now;
+    }
+    samplesOffered++;
+
+    LogRecord record;
+    record.epoch = (uint32_t)timestamp;
+    record.centiCelsius = (int16_t)lroundf(temperature * 100.0f);
+    record.sensorId = sensorId;
+    record.flags = flags;
+
+    if (sensorId == 0 && !rollups.add(record.epoch, record.centiCelsius)) {
+        Serial.println("Failed to update rollups");
+    }
+
+    if (!compression) {
+        return appendToLog(record);
+    }
+
+    // A filter keeps the reading before this one, possibly older than
+    // readings of other sensors kept since, so all of them go through the queue
+    LogRecord kept;
+    if (sensorId >= MAX_FILTERED_SENSORS) {
+        queueOrdered(record);
+    } else {
+        if (flags != 0) {
+            // Logged as it is, the filter starts over from it
+            if (doors[sensorId].flush(kept)) {
+                queueOrdered(kept);
+            }
+            doors[sensorId].reset();
+        }
+        if (doors[sensorId].add(record, kept)) {
+            queueOrdered(kept);
+        }
+    }
+    uint32_t logged = samplesLogged;
+    bool released = releaseOrdered(record.epoch);
+    if (samplesLogged == logged) {
+        // Nothing logged yet, but the rollups moved on
+        saveState();
+    }
+    return released;
+}
+
+bool DataLogger::addSample(float temperature, uint8_t sensorId, time_t timestamp) {
+    if (sensorId != 0) {
+        return true;
+    }
+    if (!rollups.addQuantile((uint32_t)timestamp, (int16_t)lroundf(temperature * 100.0f))) {
+        Serial.println("Failed to update daily quantiles");
         return false;
     }
+    return true;
+}
+
+bool DataLogger::appendToLog(const LogRecord& record) {
+    if (buffer.size() == 0) {
+        pendingSince = millis();
+    }
+    buffer.push(record);
+    samplesLogged++;
+    writeThroughBytes += sizeof(LogRecord) + RingLog::getHeaderSize();
+
+    cache->add(record);
+    saveState();
 
-    file.close();
-    Serial.println("Created new log file with initial structure");
+    if (buffer.size() >= commitRecords) {
+        return flush();
+    }
     return true;
 }
 
-bool DataLogger::logTemperature(float temperature) {
-    time_t now;
-    time(&now);  // Get current timestamp
-    
-    lastTemperature = temperature;
-    lastLogTime = now;
+void DataLogger::queueOrdered(const LogRecord& record) {
+    // Behind queued readings of the same time, so those keep their order
+    uint8_t i = orderedCount;
+    while (i > 0 && ordered[i - 1].epoch > record.epoch) {
+        ordered[i] = ordered[i - 1];
+        i--;
+    }
+    ordered[i] = record;
+    orderedCount++;
+}
+
+bool DataLogger::releaseOrdered(uint32_t now) {
+    bool logged = true;
+    while (true) {
+        // A filter may still keep its held reading, nothing else it keeps is older
+        int oldest = -1;
+        for (uint8_t sensor = 0; sensor < MAX_FILTERED_SENSORS; sensor++) {
+            if (doors[sensor].isHolding()
+                && (oldest < 0 || doors[sensor].getHeldEpoch() < doors[oldest].getHeldEpoch())) {
+                oldest = sensor;
+            }
+        }
+        uint32_t watermark = oldest >= 0 ? min(now, doors[oldest].getHeldEpoch()) : UINT32_MAX;
+
+        uint8_t n = 0;
+        while (n < orderedCount && ordered[n].epoch <= watermark) {
+            logged = appendToLog(ordered[n]) && logged;
+            n++;
+        }
+        memmove(ordered, ordered + n, (orderedCount - n) * sizeof(LogRecord));
+        orderedCount -= n;
+        // Room for the two readings a flagged one may queue
+        if (orderedCount < ORDER_CAPACITY - 1) {
+            return logged;
+        }
+
+        // Everything queued is newer than the oldest held reading, so it can
+        // be logged right away
+        LogRecord kept;
+        doors[oldest].flush(kept);
+        logged = appendToLog(kept) && logged;
+    }
+}
 
-    return appendToLog(temperature, now);
+void DataLogger::saveState() {
+    // Everything needed to replay the buffer after a reset, under one CRC
+    RollupRecord buckets[ROLLUP_TIER_COUNT];
+    rollups.getOpenBuckets(buckets);
+    buffer.setOpenBuckets(buckets);
+    buffer.setLastLogTime(lastLogTime);
+    buffer.seal();
 }
 
-bool DataLogger::appendToLog(float temperature, time_t timestamp) {
-    String jsonData;
-    JsonDocument doc;
+void DataLogger::replayBuffer() {
+    uint32_t n = buffer.size();
 
-    // Read existing file content
-    File file = SPIFFS.open(filename, "r");
-    if (!file) {
-        Serial.println("Failed to open log file for reading, creating new file");
-        file.close();
-        if (!createLogFile()) {
-            return false;
+    // The batch may have reached flash just before the reset; a log that
+    // restarted its sequence was recreated and needs all of it
+    uint32_t sequence = ringLog.getSequence();
+    uint32_t base = buffer.getBaseSequence();
+    uint32_t written = sequence >= base ? min(sequence - base, n) : 0;
+
+    if (written < n) {
+        if (ringLog.append(buffer.getRecords() + written, n - written)) {
+            Serial.printf("Replayed %lu readings from RTC memory\n", (unsigned long)(n - written));
+        } else {
+            Serial.println("Failed to replay readings from RTC memory");
         }
-        file = SPIFFS.open(filename, "r");
-        if (!file) {
-            return false;
+    }
+
+    // With nothing buffered the saved buckets were flushed already, and may
+    // be stale if the rollup files were recreated since
+    if (n > 0) {
+        rollups.restoreOpenBuckets(buffer.getOpenBuckets());
+        if (!rollups.flush()) {
+            Serial.println("Failed to update rollups");
         }
     }
+    buffer.clear(ringLog.getSequence());
+}
 
-    // Read the file content into a String
-    while (file.available()) {
-        jsonData += (char)file.read();
+void DataLogger::update() {
+    if (buffer.size() > 0 && millis() - pendingSince >= commitMillis) {
+        flush();
     }
-    file.close();
+}
 
-    // Parse existing JSON
-    DeserializationError error = deserializeJson(doc, jsonData);
-    if (error) {
-        Serial.print("Failed to parse log file: ");
-        Serial.println(error.c_str());
-        // If parsing fails, create a new file
-        if (!createLogFile()) {
-            return false;
+bool DataLogger::flush() {
+    uint32_t n = buffer.size();
+    if (n > 0) {
+        if (!ringLog.append(buffer.getRecords(), n)) {
+            Serial.println("Failed to append to log file");
+            // Reopen the file once in case the handle went stale, which also
+            // forgets the part of the batch that made it out
+            if (!ringLog.begin() || !ringLog.append(buffer.getRecords(), n)) {
+                return false;
+            }
+        }
+        flushCount++;
+
+        for (uint32_t i = 0; i < n; i++) {
+            archive.add(buffer.getRecords()[i]);
         }
-        // Initialize new document with empty readings array
-        doc.clear();
-        doc["readings"] = JsonArray();
     }
 
-    // Ensure readings array exists
-    if (!doc.containsKey("readings") || doc["readings"].isNull()) {
-        doc["readings"] = JsonArray();
+    if (!rollups.flush()) {
+        Serial.println("Failed to update rollups");
     }
+    buffer.clear(ringLog.getSequence());
+    return true;
+}
 
-    // Format time string
-    struct tm timeinfo;
-    localtime_r(&timestamp, &timeinfo);
-    char timeStr[20];
-    strftime(timeStr, sizeof(timeStr), "%H:%M:%S", &timeinfo);
+void DataLogger::setCommitPolicy(uint32_t records, uint32_t seconds) {
+    commitRecords = records > 0 ? records : 1;
+    if (commitRecords > MAX_COMMIT_RECORDS) {
+        commitRecords = MAX_COMMIT_RECORDS;
+    }
+    commitMillis = seconds * 1000UL;
+    if (buffer.size() >= commitRecords) {
+        flush();
+    }
+}
 
-    // Add new reading
-    JsonArray readings = doc["readings"];
-    JsonObject reading = readings.add<JsonObject>();
-    reading["timestamp"] = timeStr;  // Store only the formatted time string
-    reading["temperature"] = temperature;
+void DataLogger::setCompression(bool enabled, float tolerance, uint32_t heartbeat) {
+    if (enabled == compression && tolerance == toleranceCelsius && heartbeat == heartbeatSeconds) {
+        return;
+    }
 
-    // Trim old readings if necessary (keep last 1000 readings)
-    while (readings.size() > 1000) {
-        readings.remove(0);
+    compression = enabled;
+    toleranceCelsius = tolerance;
+    heartbeatSeconds = heartbeat;
+    // The reading each filter holds back is dropped, the next one is logged
+    for (uint8_t sensor = 0; sensor < MAX_FILTERED_SENSORS; sensor++) {
+        doors[sensor].configure(tolerance * 100.0f, heartbeat);
     }
+    // With nothing held any more, no queued reading has to wait
+    releaseOrdered(UINT32_MAX);
+}
 
-    // Write updated JSON back to file
-    file = SPIFFS.open(filename, "w");
-    if (!file) {
-        Serial.println("Failed to open log file for writing");
-        return false;
+uint32_t DataLogger::getEntryCount() const {
+    uint32_t entries = ringLog.size() + buffer.size();
+    return min(entries, ringLog.getRetention());
+}
+
+void DataLogger::warmCache() {
+    cache->clear();
+
+    uint32_t count;
+    RingLog::Reader reader = ringLog.openRangeReader(0, 0, cache->getCapacity(), count);
+    LogRecord batch[32];
+    size_t n;
+    while ((n = reader.read(batch, min((uint32_t)32, reader.remaining()))) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            cache->add(batch[i]);
+        }
     }
+}
 
-    // Serialize with pretty printing for easier debugging
-    if (serializeJson(doc, file) == 0) {
-        Serial.println("Failed to write to log file");
-        file.close();
-        return false;
+bool DataLogger::setMaxEntries(uint32_t maxEntries) {
+    if (maxEntries == ringLog.getRetention()) {
+        return true;
     }
 
-    file.close();
+    // Buffered readings are subject to the new retention as well
+    flush();
+
+    unsigned long started = micros();
+    bool resized = ringLog.setRetention(maxEntries);
+    lastResizeMicros = micros() - started;
+
+    if (!resized) {
+        Serial.println("Failed to change log retention");
+        return false;
+    }
+    Serial.printf("Log retention set to %lu readings in %lu us\n",
+                  (unsigned long)maxEntries, (unsigned long)lastResizeMicros);
     return true;
 }
 
+RingLog::Reader DataLogger::openRangeReader(time_t from, time_t to, uint32_t limit, uint32_t& count) const {
+    return ringLog.openRangeReader(from, to, limit, count);
+}
+
 bool DataLogger::shouldLog() {
     time_t now;
     time(&now);
-    return (now - lastLogTime) >= intervalSeconds;
-} 
\ No newline at end of file
+    return compression || (now - lastLogTime) >= intervalSeconds;
+} 
@@ -3,18 +3,57 @@
 
 #include <Arduino.h>
 #include <SPIFFS.h>
-#include <ArduinoJson.h>
+#include "RingLog.h"
+#include "RollupStore.h"
+#include "BlockArchive.h"
+#include "SampleCache.h"
+#include "RtcSampleBuffer.h"
+#include "SwingingDoor.h"
+#include <memory>
 
+/**
+ * @brief Stores temperature readings in a binary ring log with rollups
+ * 
+ * Readings are group-committed: they are collected in RAM and written to
+ * flash as one batch when the batch is full, when the oldest buffered reading
+ * has waited for the commit interval, or when flush() is called. The RAM
+ * cache sees every reading at once, flash readers only after the batch is
+ * written.
+ *
+ * The batch lives in RTC memory together with the open rollup buckets, so a
+ * software reset or deep sleep loses nothing: begin() replays what the
+ * previous boot left. Only power loss drops the buffered readings.
+ *
+ * Written readings are also compressed into a BlockArchive, which keeps
+ * months of raw history in the space of a few weeks of the ring log.
+ *
+ * With compression on, every reading is offered and a SwingingDoor per
+ * sensor keeps only those needed to redraw the signal within a tolerance by
+ * interpolating between them. Rollups still see every reading. A filter
+ * keeps a reading only once it has seen the next one, so kept readings wait
+ * in RAM until no filter can still keep an older one, which keeps the log in
+ * time order. That is usually one sampling round; like the reading a filter
+ * holds back, they are lost on reset.
+ */
 class DataLogger {
 public:
+    static const uint32_t MAX_COMMIT_RECORDS = RtcSampleBuffer::CAPACITY;
+    static const uint32_t ARCHIVE_BLOCKS = 1024;  // 128 KB of compressed readings
+    static const uint8_t MAX_FILTERED_SENSORS = BlockArchive::MAX_SENSORS;
+    static const uint8_t ORDER_CAPACITY = 2 * MAX_FILTERED_SENSORS;
+
     /**
      * @brief Construct a new Data Logger object
      * 
      * @param logFileName Name of the file to store temperature logs
      * @param loggingIntervalSeconds Interval between temperature readings in seconds
+     * @param maxEntries Number of readings kept before the oldest are overwritten
+     * @param cacheEntries Number of newest readings also kept in RAM
      */
-    DataLogger(const char* logFileName = "/temperature_log.json", 
-               unsigned long loggingIntervalSeconds = 300);  // 300 seconds = 5 minutes
+    DataLogger(const char* logFileName = "/temperature_log.bin", 
+               unsigned long loggingIntervalSeconds = 300,  // 300 seconds = 5 minutes
+               uint32_t maxEntries = 1000,
+               uint32_t cacheEntries = 1024);
 
     /**
      * @brief Initialize the data logger
@@ -25,24 +64,163 @@ public:
     bool begin();
 
     /**
-     * @brief Log a temperature reading with current timestamp
+     * @brief Log a temperature reading
+     * 
+     * Rollups are kept for the primary sensor (id 0) only. With compression
+     * on, the reading may be left out of the log unless it is flagged, which
+     * is logged unchanged. A flagged reading may be logged before the
+     * interval is up without delaying the next one.
      * 
      * @param temperature Temperature value in Celsius
+     * @param sensorId Index of the sensor that produced the reading
+     * @param timestamp Time the reading was taken, 0 for the current time
+     * @param flags Status bits stored with the reading, see AnomalyFlag
      * @return true if logging was successful
      * @return false if logging failed
      */
-    bool logTemperature(float temperature);
+    bool logTemperature(float temperature, uint8_t sensorId = 0, time_t timestamp = 0, uint8_t flags = 0);
+
+    /**
+     * @brief Feed a sample into the daily quantiles
+     * 
+     * Call for every sample, logged or not, so the daily p50/p95/p99 reflect
+     * the sampling rate rather than the logging interval. Quantiles are kept
+     * for the primary sensor (id 0) only and are written with the rollups.
+     * 
+     * @param temperature Temperature value in Celsius
+     * @param sensorId Index of the sensor that produced the sample
+     * @param timestamp Time the sample was taken
+     * @return true if the quantiles were updated or the sensor has none
+     * @return false if the previous day could not be written
+     */
+    bool addSample(float temperature, uint8_t sensorId, time_t timestamp);
+
+    /**
+     * @brief Write buffered readings to flash once the commit interval is up
+     * 
+     * Call regularly from the logging task.
+     */
+    void update();
+
+    /**
+     * @brief Write all buffered readings and open rollup buckets to flash
+     * 
+     * @return true if everything was written
+     * @return false if a write failed, the readings stay buffered
+     */
+    bool flush();
+
+    /**
+     * @brief Set when buffered readings are written to flash
+     * 
+     * @param records Readings per batch, 1 to write every reading through
+     * @param seconds Longest time a reading may stay buffered
+     */
+    void setCommitPolicy(uint32_t records, uint32_t seconds);
+
+    /**
+     * @brief Get the number of readings waiting to be written
+     */
+    uint32_t getPendingCount() const { return buffer.size(); }
+
+    /**
+     * @brief Get the number of readings logged since boot
+     */
+    uint32_t getSamplesLogged() const { return samplesLogged; }
+
+    /**
+     * @brief Get the number of readings passed to logTemperature() since boot
+     * 
+     * Compared with getSamplesLogged() this gives the share compression left out.
+     */
+    uint32_t getSamplesOffered() const { return samplesOffered; }
+
+    /**
+     * @brief Log only the readings needed to reconstruct the signal
+     * 
+     * While enabled, shouldLog() is always true and logTemperature() passes
+     * each reading through a swinging-door filter for its sensor. Sensors
+     * beyond MAX_FILTERED_SENSORS are logged unfiltered.
+     * 
+     * @param enabled Whether to filter readings
+     * @param toleranceCelsius Largest error of a reading interpolated from the log
+     * @param heartbeatSeconds Longest time between logged readings of a sensor
+     */
+    void setCompression(bool enabled, float toleranceCelsius, uint32_t heartbeatSeconds);
+
+    bool isCompressionEnabled() const { return compression; }
+
+    /**
+     * @brief Get the longest gap between logged readings that is still one signal
+     * 
+     * Readers interpolating the log should not bridge longer gaps, the sensor
+     * or the logger was down during them.
+     * 
+     * @return uint32_t Seconds
+     */
+    uint32_t getMaxGap() const { return 2 * (compression ? heartbeatSeconds : intervalSeconds); }
+
+    /**
+     * @brief Get the number of batches written since boot
+     */
+    uint32_t getFlushCount() const { return flushCount; }
+
+    /**
+     * @brief Get the bytes written to the log and rollup files since boot
+     */
+    uint32_t getFlashBytesWritten() const {
+        return ringLog.getBytesWritten() + rollups.getBytesWritten() + archive.getBytesWritten();
+    }
+
+    /**
+     * @brief Get the bytes that writing every reading through would have cost
+     * 
+     * Compared with getFlashBytesWritten() this gives the write amplification
+     * saved by batching.
+     */
+    uint32_t getWriteThroughBytes() const { return writeThroughBytes + rollups.getWriteThroughBytes(); }
+
+    /**
+     * @brief Change the interval between logged readings
+     * 
+     * @param loggingIntervalSeconds Interval between temperature readings in seconds
+     */
+    void setLoggingInterval(unsigned long loggingIntervalSeconds) { intervalSeconds = loggingIntervalSeconds; }
+
+    /**
+     * @brief Change the number of readings kept, without rewriting the log
+     * 
+     * Shrinking drops the oldest readings at once. The time taken is kept
+     * for getLastResizeMicros().
+     * 
+     * @param maxEntries Number of readings kept before the oldest are overwritten
+     * @return true if the new retention was stored
+     * @return false if the log header could not be written
+     */
+    bool setMaxEntries(uint32_t maxEntries);
+
+    /**
+     * @brief Get the number of readings kept before the oldest are overwritten
+     */
+    uint32_t getMaxEntries() const { return ringLog.getRetention(); }
+
+    /**
+     * @brief Get the time the last setMaxEntries() call took
+     * 
+     * @return uint32_t Microseconds, 0 if the retention was never changed
+     */
+    uint32_t getLastResizeMicros() const { return lastResizeMicros; }
 
     /**
      * @brief Check if it's time to log a new reading
      * 
-     * @return true if logging interval has elapsed
+     * @return true if logging interval has elapsed or compression is on
      * @return false if it's not time to log yet
      */
     bool shouldLog();
 
     /**
-     * @brief Get the last logged temperature
+     * @brief Get the last logged temperature of the primary sensor
      * 
      * @return float Last logged temperature value
      */
@@ -55,29 +233,135 @@ public:
      */
     time_t getLastLogTime() const { return lastLogTime; }
 
+    /**
+     * @brief Get the number of readings currently stored, buffered ones included
+     * 
+     * @return uint32_t Number of stored readings
+     */
+    uint32_t getEntryCount() const;
+
+    /**
+     * @brief Open a reader over the stored readings, oldest first
+     * 
+     * @return RingLog::Reader Reader with its own file handle
+     */
+    RingLog::Reader openReader() const { return ringLog.openReader(); }
+
+    /**
+     * @brief Open a reader positioned at the readings within a time range
+     * 
+     * @param from Oldest timestamp to include, 0 for no lower bound
+     * @param to Newest timestamp to include, 0 for no upper bound
+     * @param limit Maximum number of readings, keeping the newest, 0 for no limit
+     * @param count Receives the number of readings left to read from the reader
+     * @return RingLog::Reader Reader positioned at the first matching reading
+     */
+    RingLog::Reader openRangeReader(time_t from, time_t to, uint32_t limit, uint32_t& count) const;
+
+    /**
+     * @brief Look up a time range in the RAM cache of recent readings
+     * 
+     * @param from Oldest timestamp to include, 0 for no lower bound
+     * @param to Newest timestamp to include, 0 for no upper bound
+     * @param limit Maximum number of readings, keeping the newest, 0 for no limit
+     * @param cursor Receives the position of the first matching reading
+     * @return true if the cache can answer for the whole range
+     * @return false if the range has to be read with openRangeReader()
+     */
+    bool findCachedRange(time_t from, time_t to, uint32_t limit, SampleCache::Cursor& cursor) const {
+        return cache->findRange(from, to, limit, getEntryCount(), cursor);
+    }
+
+    /**
+     * @brief Get the RAM cache of recent readings
+     * 
+     * @return std::shared_ptr<SampleCache> Cache, shared so readers may outlive the logger
+     */
+    std::shared_ptr<SampleCache> getCache() const { return cache; }
+
+    /**
+     * @brief Get the minute/hour/day rollups maintained alongside the raw log
+     * 
+     * @return const RollupStore& Rollup tiers for long-range queries
+     */
+    const RollupStore& getRollups() const { return rollups; }
+
+    /**
+     * @brief Get the compressed archive of written readings
+     * 
+     * @return const BlockArchive& Archive for queries beyond the ring log's retention
+     */
+    const BlockArchive& getArchive() const { return archive; }
+
 private:
     const char* filename;
     unsigned long intervalSeconds;
     time_t lastLogTime;
     float lastTemperature;
+    uint32_t lastResizeMicros;
+    RingLog ringLog;
+    RollupStore rollups;
+    BlockArchive archive;
+    std::shared_ptr<SampleCache> cache;
+
+    RtcSampleBuffer buffer;                 // Readings not yet written to flash
+    unsigned long pendingSince;             // millis() when the oldest buffered reading arrived
+    uint32_t commitRecords;
+    unsigned long commitMillis;
+    uint32_t samplesLogged;
+    uint32_t flushCount;
+    uint32_t writeThroughBytes;             // Raw log bytes a write per reading would have cost
+
+    bool compression;
+    float toleranceCelsius;
+    uint32_t heartbeatSeconds;
+    SwingingDoor doors[MAX_FILTERED_SENSORS];
+    LogRecord ordered[ORDER_CAPACITY];      // Kept readings waiting for older ones, oldest first
+    uint8_t orderedCount;
+    uint32_t samplesOffered;
 
     /**
-     * @brief Create a new log file with initial structure
+     * @brief Write readings left in RTC memory by the previous boot
+     */
+    void replayBuffer();
+
+    /**
+     * @brief Fill the cache with the newest records from flash
+     */
+    void warmCache();
+
+    /**
+     * @brief Buffer a reading for the next batch
+     * 
+     * @param record Reading to log
+     * @return true if the reading was buffered, and written if the batch filled up
+     * @return false if a full batch could not be written
+     */
+    bool appendToLog(const LogRecord& record);
+
+    /**
+     * @brief Queue a reading kept with compression on, in time order
      * 
-     * @return true if file creation was successful
-     * @return false if file creation failed
+     * @param record Reading to log once releaseOrdered() lets it through
      */
-    bool createLogFile();
+    void queueOrdered(const LogRecord& record);
 
     /**
-     * @brief Append a temperature reading to the log file
+     * @brief Log the queued readings no filter can still keep an older one than
+     * 
+     * If the queue stays close to full, the filter holding the oldest reading
+     * keeps it at once to make room.
      * 
-     * @param temperature Temperature value to log
-     * @param timestamp Unix timestamp of the reading
-     * @return true if append was successful
-     * @return false if append failed
+     * @param now Time of the newest reading offered, later ones are not older
+     * @return true if the readings were logged
+     * @return false if a full batch could not be written
+     */
+    bool releaseOrdered(uint32_t now);
+
+    /**
+     * @brief Seal the open rollup buckets and last log time into RTC memory
      */
-    bool appendToLog(float temperature, time_t timestamp);
+    void saveState();
 };
 
 #endif // DATA_LOGGER_H 
\ No newline at end of file
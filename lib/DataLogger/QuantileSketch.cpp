@@ -0,0 +1,105 @@
+#include "QuantileSketch.h"
+
+namespace {
+    // Desired rank of each marker as a fraction of the readings
+    const float MARKER_PROBABILITY[QuantileRecord::MARKERS] = {
+        0.0f, 0.25f, 0.5f, 0.725f, 0.95f, 0.97f, 0.99f, 0.995f, 1.0f
+    };
+
+    const uint8_t QUANTILE_MARKER[QUANTILE_COUNT] = { 2, 4, 6 };
+}
+
+void QuantileSketch::reset(QuantileRecord& record, uint32_t epoch) {
+    memset(&record, 0, sizeof(record));
+    record.epoch = epoch;
+}
+
+void QuantileSketch::add(QuantileRecord& record, int16_t centiCelsius) {
+    const uint8_t last = QuantileRecord::MARKERS - 1;
+    float* h = record.heights;
+    uint32_t* n = record.positions;
+    float x = centiCelsius;
+
+    // The first readings become the markers, kept sorted
+    if (record.count < QuantileRecord::MARKERS) {
+        uint8_t i = record.count;
+        while (i > 0 && h[i - 1] > x) {
+            h[i] = h[i - 1];
+            i--;
+        }
+        h[i] = x;
+        record.count++;
+        for (uint8_t k = 0; k < record.count; k++) {
+            n[k] = k + 1;
+        }
+        return;
+    }
+
+    // Find the cell the reading falls into, stretching the ends if needed
+    uint8_t cell;
+    if (x < h[0]) {
+        h[0] = x;
+        cell = 0;
+    } else if (x >= h[last]) {
+        h[last] = x;
+        cell = last - 1;
+    } else {
+        cell = 0;
+        while (x >= h[cell + 1]) {
+            cell++;
+        }
+    }
+    for (uint8_t i = cell + 1; i <= last; i++) {
+        n[i]++;
+    }
+    record.count++;
+
+    // Move inner markers that drifted a whole rank from where they should be
+    for (uint8_t i = 1; i < last; i++) {
+        float desired = 1.0f + (record.count - 1) * MARKER_PROBABILITY[i];
+        float drift = desired - n[i];
+        int32_t below = (int32_t)n[i - 1] - (int32_t)n[i];
+        int32_t above = (int32_t)n[i + 1] - (int32_t)n[i];
+        if (!((drift >= 1.0f && above > 1) || (drift <= -1.0f && below < -1))) {
+            continue;
+        }
+
+        int32_t step = drift > 0 ? 1 : -1;
+        float parabolic = h[i] + (float)step / (above - below) *
+            ((-below + step) * (h[i + 1] - h[i]) / above +
+             (above - step) * (h[i] - h[i - 1]) / -below);
+        if (h[i - 1] < parabolic && parabolic < h[i + 1]) {
+            h[i] = parabolic;
+        } else {
+            uint8_t neighbour = step > 0 ? i + 1 : i - 1;
+            h[i] += step * (h[neighbour] - h[i]) / ((int32_t)n[neighbour] - (int32_t)n[i]);
+        }
+        n[i] += step;
+    }
+}
+
+float QuantileSketch::get(const QuantileRecord& record, Quantile quantile) {
+    if (record.count == 0) {
+        return 0.0f;
+    }
+    if (record.count < QuantileRecord::MARKERS) {
+        // Still the sorted readings themselves
+        return record.heights[lroundf(getProbability(quantile) * (record.count - 1))];
+    }
+    return record.heights[QUANTILE_MARKER[quantile]];
+}
+
+float QuantileSketch::getMin(const QuantileRecord& record) {
+    return record.heights[0];
+}
+
+float QuantileSketch::getMax(const QuantileRecord& record) {
+    if (record.count == 0) {
+        return 0.0f;
+    }
+    return record.heights[record.count < QuantileRecord::MARKERS ? record.count - 1 : QuantileRecord::MARKERS - 1];
+}
+
+float QuantileSketch::getProbability(Quantile quantile) {
+    return MARKER_PROBABILITY[QUANTILE_MARKER[quantile]];
+}
@@ -0,0 +1,68 @@
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <Arduino.h>
+
+/**
+ * @brief State of a streaming p50/p95/p99 estimate over one period
+ *
+ * Holds the markers of the extended P² algorithm (Jain & Chlamtac,
+ * Raatikainen), so the same bytes are both the running estimate and what is
+ * stored once the period ends. The markers track the minimum, the three
+ * quantiles, the points halfway between them and the maximum.
+ */
+struct QuantileRecord {
+    static const uint8_t MARKERS = 9;
+
+    uint32_t epoch;                 // Start of the period (UTC aligned)
+    uint32_t count;                 // Readings seen
+    float heights[MARKERS];         // Marker values in 1/100 °C, sorted
+    uint32_t positions[MARKERS];    // Marker ranks, 1-based
+};
+
+enum Quantile {
+    QUANTILE_P50,
+    QUANTILE_P95,
+    QUANTILE_P99,
+    QUANTILE_COUNT
+};
+
+/**
+ * @brief Streaming quantile estimator working on a QuantileRecord
+ *
+ * Every reading moves the markers towards their desired ranks with a
+ * piecewise-parabolic fit, in O(1) time and a fixed 80 bytes. Until there are
+ * MARKERS readings the markers are the readings themselves and the quantiles
+ * are exact.
+ */
+class QuantileSketch {
+public:
+    /**
+     * @brief Start a new period
+     */
+    static void reset(QuantileRecord& record, uint32_t epoch);
+
+    /**
+     * @brief Add a reading
+     *
+     * @param centiCelsius Temperature in 1/100 °C
+     */
+    static void add(QuantileRecord& record, int16_t centiCelsius);
+
+    /**
+     * @brief Get the estimate of a quantile
+     *
+     * @return float Temperature in 1/100 °C, 0 without readings
+     */
+    static float get(const QuantileRecord& record, Quantile quantile);
+
+    static float getMin(const QuantileRecord& record);
+    static float getMax(const QuantileRecord& record);
+
+    /**
+     * @brief Get the probability of a quantile, e.g. 0.95 for QUANTILE_P95
+     */
+    static float getProbability(Quantile quantile);
+};
+
+#endif // QUANTILE_SKETCH_H
@@ -0,0 +1,450 @@
+#include "RingLog.h"
+
+RingLog::RingLog(fs::FS& fs, const char* path, uint32_t capacity, size_t recordSize)
+    : fs(fs)
+    , path(path)
+    , recordSize(recordSize < MAX_RECORD_SIZE ? recordSize : MAX_RECORD_SIZE)
+    , capacity(capacity > 0 ? capacity : 1)
+    , retention(this->capacity)
+    , head(0)
+    , count(0)
+    , sequence(0)
+    , bytesWritten(0)
+{
+}
+
+bool RingLog::begin() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (file) {
+        file.close();
+    }
+
+    if (!fs.exists(path)) {
+        return format();
+    }
+
+    file = fs.open(path, "r+");
+    if (!file) {
+        Serial.println("Failed to open log file");
+        return false;
+    }
+
+    // Validate the header against the layout this build expects. The capacity
+    // may differ, it is adopted and then resized to the configured retention.
+    Header header;
+    bool valid = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header)
+        && header.magic == MAGIC
+        && header.version == VERSION
+        && header.recordSize == recordSize
+        && header.capacity > 0
+        && header.head < header.capacity
+        && header.count <= header.capacity;
+
+    // Every visible record must be in the file
+    uint32_t fileSlots = 0;
+    if (valid) {
+        fileSlots = (file.size() - sizeof(header)) / recordSize;
+        valid = fileSlots >= (header.count <= header.head ? header.head : header.capacity);
+    }
+
+    if (!valid) {
+        Serial.println("Log file header invalid or layout changed, reformatting");
+        file.close();
+        return format();
+    }
+
+    capacity = header.capacity;
+    head = header.head;
+    count = header.count;
+    sequence = header.sequence;
+    if (!buildIndex(fileSlots)) {
+        return false;
+    }
+
+    if (retention != capacity) {
+        Serial.printf("Resizing log from %lu to %lu records\n",
+                      (unsigned long)capacity, (unsigned long)retention);
+        return applyRetention(retention);
+    }
+    return true;
+}
+
+bool RingLog::buildIndex(uint32_t fileSlots) {
+    blockEpochs.assign((capacity + INDEX_BLOCK - 1) / INDEX_BLOCK, 0);
+
+    // Entries for slots never written are never looked at, see lowerBound()
+    uint32_t written = min(capacity, fileSlots);
+    for (uint32_t slot = 0; slot < written; slot += INDEX_BLOCK) {
+        uint32_t epoch;
+        if (!file.seek(slotOffset(slot)) ||
+            file.read((uint8_t*)&epoch, sizeof(epoch)) != sizeof(epoch)) {
+            Serial.println("Failed to read log index");
+            return false;
+        }
+        blockEpochs[slot / INDEX_BLOCK] = epoch;
+    }
+    return true;
+}
+
+bool RingLog::format() {
+    if (file) {
+        file.close();
+    }
+
+    // Truncate, then reopen for in-place updates
+    File created = fs.open(path, "w");
+    if (!created) {
+        Serial.println("Failed to create log file");
+        return false;
+    }
+    created.close();
+
+    file = fs.open(path, "r+");
+    if (!file) {
+        Serial.println("Failed to open log file");
+        return false;
+    }
+
+    capacity = retention;
+    head = 0;
+    count = 0;
+    sequence = 0;
+    blockEpochs.assign((capacity + INDEX_BLOCK - 1) / INDEX_BLOCK, 0);
+    if (!writeHeader()) {
+        Serial.println("Failed to write log header");
+        return false;
+    }
+
+    Serial.println("Created new binary log file");
+    return true;
+}
+
+bool RingLog::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    return format();
+}
+
+bool RingLog::setRetention(uint32_t records) {
+    std::lock_guard<std::mutex> guard(lock);
+    return applyRetention(records);
+}
+
+bool RingLog::applyRetention(uint32_t records) {
+    retention = records > 0 ? records : 1;
+    if (count > retention) {
+        count = retention;
+    }
+
+    // If no visible record lies past the head, the ring can take its new size
+    // now; otherwise append() converges on it within one lap
+    if (count <= head) {
+        capacity = retention > head ? retention : head + 1;
+        resizeIndex();
+    } else if (head == 0 && retention > capacity) {
+        // Just wrapped, so the newest record is in the last slot: keep going from there
+        head = capacity;
+        capacity = retention;
+        resizeIndex();
+    }
+
+    if (!file) {
+        return true;
+    }
+    return writeHeader();
+}
+
+bool RingLog::writeHeader() {
+    Header header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.recordSize = recordSize;
+    header.capacity = capacity;
+    header.head = head;
+    header.count = count;
+    header.sequence = sequence;
+
+    if (!file.seek(0)) {
+        return false;
+    }
+    if (file.write((const uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+        return false;
+    }
+    bytesWritten += sizeof(header);
+    file.flush();
+    return true;
+}
+
+bool RingLog::append(const void* record) {
+    return append(record, 1);
+}
+
+bool RingLog::append(const void* records, size_t n) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!file) {
+        return false;
+    }
+
+    // Records go into the file cache, the header write flushes them together
+    for (size_t i = 0; i < n; i++) {
+        if (!writeRecord((const uint8_t*)records + i * recordSize)) {
+            return false;
+        }
+    }
+    return writeHeader();
+}
+
+bool RingLog::writeRecord(const void* record) {
+    // Until the first wrap, or while growing, the head slot is the end of the file
+    if (!file.seek(slotOffset(head))) {
+        return false;
+    }
+    if (file.write((const uint8_t*)record, recordSize) != recordSize) {
+        return false;
+    }
+    bytesWritten += recordSize;
+
+    if (head % INDEX_BLOCK == 0) {
+        memcpy(&blockEpochs[head / INDEX_BLOCK], record, sizeof(uint32_t));
+    }
+    if (count < capacity) {
+        count++;
+    }
+    if (count > retention) {
+        count = retention;
+    }
+
+    uint32_t next = head + 1;
+    if (next == capacity) {
+        if (retention > capacity) {
+            // Grow past the old end of the ring instead of wrapping
+            capacity = retention;
+            resizeIndex();
+        } else {
+            next = 0;
+        }
+    } else if (next >= retention && count <= next) {
+        // Shrinking and nothing visible lies beyond this slot, so end the ring here
+        capacity = next;
+        resizeIndex();
+        next = 0;
+    }
+    head = next;
+    sequence++;
+    return true;
+}
+
+bool RingLog::updateLast(const void* record) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!file || count == 0) {
+        return false;
+    }
+
+    uint32_t slot = (head + capacity - 1) % capacity;
+    if (!file.seek(slotOffset(slot))) {
+        return false;
+    }
+    if (file.write((const uint8_t*)record, recordSize) != recordSize) {
+        return false;
+    }
+    bytesWritten += recordSize;
+    file.flush();
+    return true;
+}
+
+bool RingLog::readLast(void* record) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!file || count == 0) {
+        return false;
+    }
+
+    uint32_t slot = (head + capacity - 1) % capacity;
+    if (!file.seek(slotOffset(slot))) {
+        return false;
+    }
+    return file.read((uint8_t*)record, recordSize) == recordSize;
+}
+
+uint32_t RingLog::lowerBound(Reader& reader, uint32_t epoch) const {
+    if (reader.count == 0) {
+        return 0;
+    }
+
+    // Only the index search needs the lock, the block scan uses the reader's
+    // own file handle
+    uint32_t scanFrom;
+    uint32_t scanTo;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        uint32_t blocks = blockEpochs.size();
+        if (blocks == 0 || reader.capacity != capacity) {
+            return 0;
+        }
+
+        // Walk indexed blocks in logical order, starting with the first block that
+        // begins at or after the oldest record. Block j starts at logical index
+        // logicalStart(j), which grows with j.
+        uint32_t firstBlock = ((reader.start + INDEX_BLOCK - 1) / INDEX_BLOCK) % blocks;
+        auto logicalStart = [&](uint32_t j) {
+            uint32_t slot = ((firstBlock + j) % blocks) * INDEX_BLOCK;
+            return (slot + capacity - reader.start) % capacity;
+        };
+
+        // Number of indexed blocks that fall inside the reader's snapshot
+        uint32_t lo = 0;
+        uint32_t hi = blocks;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (logicalStart(mid) < reader.count) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        uint32_t indexed = lo;
+
+        // Last indexed block whose first record is still before the target
+        lo = 0;
+        hi = indexed;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (blockEpochs[(firstBlock + mid) % blocks] < epoch) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        // The answer lies between the start of block lo - 1 and the start of block lo
+        scanFrom = lo == 0 ? 0 : logicalStart(lo - 1);
+        scanTo = lo < indexed ? logicalStart(lo) : reader.count;
+    }
+
+    if (!reader.seek(scanFrom)) {
+        return reader.count;
+    }
+
+    uint8_t batch[256];
+    uint32_t perBatch = max((size_t)1, sizeof(batch) / recordSize);
+    uint32_t index = scanFrom;
+    while (index < scanTo) {
+        size_t n = reader.read(batch, min(perBatch, scanTo - index));
+        if (n == 0) {
+            break;
+        }
+        for (size_t i = 0; i < n; i++, index++) {
+            uint32_t recordEpoch;
+            memcpy(&recordEpoch, batch + i * recordSize, sizeof(recordEpoch));
+            if (recordEpoch >= epoch) {
+                return index;
+            }
+        }
+    }
+    return scanTo;
+}
+
+RingLog::Reader RingLog::openRangeReader(uint32_t from, uint32_t to, uint32_t limit, uint32_t& count) const {
+    Reader reader = openReader();
+    count = 0;
+    if (!reader.isValid()) {
+        return reader;
+    }
+
+    // Records are appended in time order, so the range is one contiguous run
+    uint32_t first = from > 0 ? lowerBound(reader, from) : 0;
+    uint32_t end = to > 0 ? lowerBound(reader, to + 1) : reader.size();
+
+    if (first > end) {
+        first = end;
+    }
+    if (limit > 0 && end - first > limit) {
+        first = end - limit;
+    }
+
+    count = end - first;
+    reader.seek(first);
+    return reader;
+}
+
+RingLog::Reader RingLog::openReader() const {
+    Reader reader;
+    reader.file = fs.open(path, "r");
+    reader.recordSize = recordSize;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        reader.capacity = capacity;
+        reader.count = count;
+        reader.start = (head + capacity - count) % capacity;
+    }
+    reader.position = 0;
+    if (reader.file) {
+        reader.seek(0);
+    }
+    return reader;
+}
+
+uint32_t RingLog::size() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return count;
+}
+
+uint32_t RingLog::getRetention() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return retention;
+}
+
+uint32_t RingLog::getCapacity() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return capacity;
+}
+
+uint32_t RingLog::getSequence() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return sequence;
+}
+
+uint32_t RingLog::getBytesWritten() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return bytesWritten;
+}
+
+bool RingLog::Reader::seek(uint32_t index) {
+    if (index > count || !file) {
+        return false;
+    }
+    position = index;
+    if (position == count) {
+        return true;
+    }
+    return file.seek(slotOffset((start + position) % capacity));
+}
+
+size_t RingLog::Reader::slotOffset(uint32_t slot) const {
+    return sizeof(Header) + (size_t)slot * recordSize;
+}
+
+bool RingLog::Reader::next(void* record) {
+    return read(record, 1) == 1;
+}
+
+size_t RingLog::Reader::read(void* records, size_t maxRecords) {
+    size_t total = 0;
+    while (total < maxRecords && position < count) {
+        uint32_t slot = (start + position) % capacity;
+
+        // Read up to the physical end of the file in one go, then wrap
+        size_t run = min((size_t)(capacity - slot), maxRecords - total);
+        run = min(run, (size_t)(count - position));
+
+        size_t bytes = run * recordSize;
+        if (file.read((uint8_t*)records + total * recordSize, bytes) != bytes) {
+            break;
+        }
+
+        total += run;
+        position += run;
+        if (slot + run == capacity && position < count) {
+            file.seek(slotOffset(0));
+        }
+    }
+    return total;
+}
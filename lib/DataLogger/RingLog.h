@@ -0,0 +1,271 @@
+#ifndef RING_LOG_H
+#define RING_LOG_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief A single fixed-size slot in the binary temperature log
+ */
+struct LogRecord {
+    uint32_t epoch;         // Unix timestamp of the reading
+    int16_t centiCelsius;   // Temperature in 1/100 °C
+    uint8_t sensorId;       // Index of the sensor in SensorManager's ROM table
+    uint8_t flags;          // AnomalyFlag bits, zero for a plain reading
+};
+
+/**
+ * @brief Append-only circular log of fixed-size records stored in a single file
+ *
+ * The file holds a small header followed by `capacity` record slots. Appending
+ * writes one record into the next slot and updates the header in place, so the
+ * cost of a log call no longer depends on how many readings are stored. Once
+ * the log is full the oldest slot is overwritten.
+ *
+ * The number of records kept, the retention, can be changed at any time
+ * without moving records. Shrinking hides the oldest records at once; the
+ * ring itself is cut down the next time the head passes the new size with
+ * nothing visible behind it. Growing takes effect as soon as the head reaches
+ * the end of the ring, or at once if the log hasn't wrapped. Either way the
+ * ring reaches its new size within one lap and the only write is the header.
+ *
+ * Records may be of any size up to MAX_RECORD_SIZE but must start with a
+ * uint32_t epoch and be appended in time order. A sparse in-memory index keeps
+ * the epoch of the first record of every block of INDEX_BLOCK slots, so a time
+ * lookup is a binary search over the index plus a scan of at most one block.
+ *
+ * The logger appends from loop() while readers are opened and searched from
+ * the web server task, so the ring state and the index are locked. Appends and
+ * resizes reallocate the index, a reader only ever sees a consistent snapshot.
+ */
+class RingLog {
+public:
+    static const size_t MAX_RECORD_SIZE = 128;
+
+    /**
+     * @brief Sequential reader over a snapshot of the log, oldest record first
+     *
+     * A reader owns its own file handle so it can be used from the web server
+     * task while the logger keeps appending.
+     */
+    class Reader {
+    public:
+        Reader() : recordSize(0), capacity(0), start(0), count(0), position(0) {}
+
+        /**
+         * @brief Check if the reader has an open file and a valid snapshot
+         */
+        bool isValid() const { return (bool)file; }
+
+        /**
+         * @brief Number of records visible to this reader
+         */
+        uint32_t size() const { return count; }
+
+        /**
+         * @brief Number of records left before the end of the snapshot
+         */
+        uint32_t remaining() const { return count - position; }
+
+        /**
+         * @brief Move to a logical record index (0 = oldest)
+         *
+         * @return false if index is past the end of the snapshot
+         */
+        bool seek(uint32_t index);
+
+        /**
+         * @brief Read the next record
+         *
+         * @param record Receives the record
+         * @return false when the end of the snapshot is reached or a read fails
+         */
+        bool next(void* record);
+
+        /**
+         * @brief Read up to maxRecords consecutive records
+         *
+         * @return size_t Number of records read
+         */
+        size_t read(void* records, size_t maxRecords);
+
+    private:
+        friend class RingLog;
+        File file;
+        size_t recordSize;
+        uint32_t capacity;
+        uint32_t start;     // Physical slot of the oldest record
+        uint32_t count;
+        uint32_t position;  // Logical index of the next record to read
+
+        size_t slotOffset(uint32_t slot) const;
+    };
+
+    /**
+     * @brief Construct a new Ring Log object
+     *
+     * @param fs Filesystem holding the log file
+     * @param path Path of the log file
+     * @param capacity Number of records to keep
+     * @param recordSize Size of one record in bytes
+     */
+    RingLog(fs::FS& fs, const char* path, uint32_t capacity, size_t recordSize = sizeof(LogRecord));
+
+    /**
+     * @brief Open the log file, creating or reformatting it if needed
+     *
+     * An existing log written with a different capacity is kept and resized
+     * to the configured one as described for setRetention().
+     *
+     * @return true if the log is ready for appends
+     * @return false if the file could not be opened or created
+     */
+    bool begin();
+
+    /**
+     * @brief Append a record, overwriting the oldest one when full
+     *
+     * @param record Record to append
+     * @return true if the record was written
+     * @return false if the write failed
+     */
+    bool append(const void* record);
+
+    /**
+     * @brief Append consecutive records with a single header write and flush
+     *
+     * @param records Array of n records
+     * @param n Number of records
+     * @return true if all records were written
+     * @return false if a write failed; records written before it stay invisible
+     */
+    bool append(const void* records, size_t n);
+
+    /**
+     * @brief Overwrite the newest record in place
+     *
+     * Used for records that accumulate over time, such as an open rollup
+     * bucket. The epoch must not change.
+     *
+     * @param record New contents of the newest record
+     * @return false if the log is empty or the write failed
+     */
+    bool updateLast(const void* record);
+
+    /**
+     * @brief Discard all records and rewrite an empty header
+     *
+     * @return true if the log was reset successfully
+     */
+    bool clear();
+
+    /**
+     * @brief Change the number of records kept without rewriting the log
+     *
+     * Records beyond the new retention are dropped immediately, oldest first.
+     * Costs one header write.
+     *
+     * @param records Number of records to keep
+     * @return false if the header could not be written
+     */
+    bool setRetention(uint32_t records);
+
+    /**
+     * @brief Open a reader over the records currently in the log
+     */
+    Reader openReader() const;
+
+    /**
+     * @brief Find the first record at or after a timestamp
+     *
+     * @param reader Reader over this log, used for the final block scan
+     * @param epoch Timestamp to search for
+     * @return uint32_t Logical index of the first record with epoch >= the
+     *         given one, or reader.size() if there is none
+     */
+    uint32_t lowerBound(Reader& reader, uint32_t epoch) const;
+
+    /**
+     * @brief Open a reader positioned at the records within a time range
+     *
+     * @param from Oldest timestamp to include, 0 for no lower bound
+     * @param to Newest timestamp to include, 0 for no upper bound
+     * @param limit Maximum number of records, keeping the newest, 0 for no limit
+     * @param count Receives the number of records left to read from the reader
+     * @return Reader Reader positioned at the first matching record
+     */
+    Reader openRangeReader(uint32_t from, uint32_t to, uint32_t limit, uint32_t& count) const;
+
+    /**
+     * @brief Read the newest record
+     *
+     * @return false if the log is empty or the read failed
+     */
+    bool readLast(void* record);
+
+    uint32_t size() const;
+    uint32_t getRetention() const;
+
+    /**
+     * @brief Number of slots in the ring right now
+     *
+     * Differs from the retention while a resize is still being applied.
+     */
+    uint32_t getCapacity() const;
+
+    /**
+     * @brief Total number of records appended since the log was created
+     */
+    uint32_t getSequence() const;
+
+    /**
+     * @brief Bytes written to the file since the log was opened, headers included
+     */
+    uint32_t getBytesWritten() const;
+
+    /**
+     * @brief Size of the header rewritten by every append or batch
+     */
+    static size_t getHeaderSize() { return sizeof(Header); }
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordSize;
+        uint32_t capacity;
+        uint32_t head;      // Physical slot the next record goes into
+        uint32_t count;
+        uint32_t sequence;
+    };
+
+    static const uint32_t MAGIC = 0x474F4C54;  // "TLOG"
+    static const uint16_t VERSION = 1;
+    static const uint32_t INDEX_BLOCK = 32;  // Records per index entry
+
+    fs::FS& fs;
+    const char* path;
+    File file;
+    size_t recordSize;
+    uint32_t capacity;      // Slots in the ring, where the head wraps
+    uint32_t retention;     // Records to keep, the capacity the ring converges to
+    uint32_t head;
+    uint32_t count;
+    uint32_t sequence;
+    uint32_t bytesWritten;
+    std::vector<uint32_t> blockEpochs;  // Epoch of the record in slot b * INDEX_BLOCK
+    mutable std::mutex lock;
+
+    // Callers hold the lock
+    bool format();
+    bool applyRetention(uint32_t records);
+    bool buildIndex(uint32_t fileSlots);
+    void resizeIndex() { blockEpochs.resize((capacity + INDEX_BLOCK - 1) / INDEX_BLOCK, 0); }
+    bool writeHeader();
+    bool writeRecord(const void* record);
+    size_t slotOffset(uint32_t slot) const { return sizeof(Header) + (size_t)slot * recordSize; }
+};
+
+#endif // RING_LOG_H
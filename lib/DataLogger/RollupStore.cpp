@@ -0,0 +1,242 @@
+#include "RollupStore.h"
+
+namespace {
+    struct TierConfig {
+        const char* name;
+        const char* path;
+        uint32_t bucketSeconds;
+        uint32_t capacity;
+    };
+
+    // Roughly 2 days of minutes, 3 months of hours and 10 years of days
+    const TierConfig TIER_CONFIG[ROLLUP_TIER_COUNT] = {
+        { "minute", "/rollup_minute.bin", 60,    2880 },
+        { "hour",   "/rollup_hour.bin",   3600,  2208 },
+        { "day",    "/rollup_day.bin",    86400, 3660 },
+    };
+
+    // 80 bytes a day, a bit over a year
+    const char* QUANTILE_PATH = "/rollup_day_quantiles.bin";
+    const uint32_t QUANTILE_CAPACITY = 400;
+}
+
+RollupStore::RollupStore(fs::FS& fs) : writeThroughBytes(0), quantilesStored(false), quantilesDirty(false) {
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        tiers[t] = new RingLog(fs, TIER_CONFIG[t].path, TIER_CONFIG[t].capacity, sizeof(RollupRecord));
+        current[t].count = 0;
+        stored[t] = false;
+        dirty[t] = false;
+    }
+    quantiles = new RingLog(fs, QUANTILE_PATH, QUANTILE_CAPACITY, sizeof(QuantileRecord));
+    QuantileSketch::reset(currentQuantiles, 0);
+}
+
+RollupStore::~RollupStore() {
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        delete tiers[t];
+    }
+    delete quantiles;
+}
+
+bool RollupStore::begin() {
+    bool success = true;
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        if (!tiers[t]->begin()) {
+            Serial.printf("Failed to open %s rollups\n", TIER_CONFIG[t].name);
+            success = false;
+            continue;
+        }
+
+        // Keep filling the newest bucket if readings continue in the same period
+        if (!tiers[t]->readLast(&current[t])) {
+            current[t].count = 0;
+        }
+        stored[t] = current[t].count > 0;
+        dirty[t] = false;
+    }
+
+    if (quantiles->begin()) {
+        if (!quantiles->readLast(&currentQuantiles)) {
+            QuantileSketch::reset(currentQuantiles, 0);
+        }
+        quantilesStored = currentQuantiles.count > 0;
+        quantilesDirty = false;
+    } else {
+        Serial.println("Failed to open daily quantiles");
+        success = false;
+    }
+    return success;
+}
+
+bool RollupStore::add(uint32_t epoch, int16_t centiCelsius) {
+    bool success = true;
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        RollupRecord& bucket = current[t];
+        uint32_t bucketStart = epoch - epoch % TIER_CONFIG[t].bucketSeconds;
+
+        // A reading older than the open bucket (clock stepped back) is folded
+        // into it rather than breaking the time order of the tier
+        if (bucket.count > 0 && bucketStart <= bucket.epoch) {
+            bucket.minCentiCelsius = min(bucket.minCentiCelsius, centiCelsius);
+            bucket.maxCentiCelsius = max(bucket.maxCentiCelsius, centiCelsius);
+            bucket.sumCentiCelsius += centiCelsius;
+            bucket.count++;
+            writeThroughBytes += sizeof(RollupRecord);
+        } else {
+            // The closed bucket must reach flash before the next one is appended
+            if (dirty[t]) {
+                success &= writeBucket(t);
+            }
+            bucket.epoch = max(bucketStart, bucket.count > 0 ? bucket.epoch : 0);
+            bucket.minCentiCelsius = centiCelsius;
+            bucket.maxCentiCelsius = centiCelsius;
+            bucket.sumCentiCelsius = centiCelsius;
+            bucket.count = 1;
+            bucket.flags = 0;
+            bucket.reserved = 0;
+            stored[t] = false;
+            writeThroughBytes += sizeof(RollupRecord) + RingLog::getHeaderSize();
+        }
+        dirty[t] = true;
+    }
+    return success;
+}
+
+bool RollupStore::addQuantile(uint32_t epoch, int16_t centiCelsius) {
+    bool success = true;
+    uint32_t dayStart = epoch - epoch % TIER_CONFIG[ROLLUP_DAY].bucketSeconds;
+
+    // Same rules as the day bucket: late readings stay in the open day
+    if (currentQuantiles.count == 0 || dayStart > currentQuantiles.epoch) {
+        if (quantilesDirty) {
+            success = writeQuantiles();
+        }
+        QuantileSketch::reset(currentQuantiles, dayStart);
+        quantilesStored = false;
+        writeThroughBytes += RingLog::getHeaderSize();
+    }
+    QuantileSketch::add(currentQuantiles, centiCelsius);
+    quantilesDirty = true;
+    writeThroughBytes += sizeof(QuantileRecord);
+    return success;
+}
+
+bool RollupStore::flush() {
+    bool success = true;
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        if (dirty[t]) {
+            success &= writeBucket(t);
+        }
+    }
+    if (quantilesDirty) {
+        success &= writeQuantiles();
+    }
+    return success;
+}
+
+bool RollupStore::writeQuantiles() {
+    bool written = quantilesStored ? quantiles->updateLast(&currentQuantiles) : quantiles->append(&currentQuantiles);
+    if (written) {
+        quantilesStored = true;
+        quantilesDirty = false;
+    }
+    return written;
+}
+
+bool RollupStore::writeBucket(int tier) {
+    bool written = stored[tier] ? tiers[tier]->updateLast(&current[tier]) : tiers[tier]->append(&current[tier]);
+    if (written) {
+        stored[tier] = true;
+        dirty[tier] = false;
+    }
+    return written;
+}
+
+void RollupStore::getOpenBuckets(RollupRecord* buckets) const {
+    memcpy(buckets, current, sizeof(current));
+}
+
+void RollupStore::restoreOpenBuckets(const RollupRecord* buckets) {
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        const RollupRecord& saved = buckets[t];
+        if (saved.count == 0 || (stored[t] && current[t].epoch > saved.epoch)) {
+            continue;
+        }
+
+        // The bucket may have been appended just before the reset
+        stored[t] = stored[t] && current[t].epoch == saved.epoch;
+        current[t] = saved;
+        dirty[t] = true;
+    }
+}
+
+uint32_t RollupStore::getBytesWritten() const {
+    uint32_t total = 0;
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        total += tiers[t]->getBytesWritten();
+    }
+    return total + quantiles->getBytesWritten();
+}
+
+RollupTier RollupStore::selectTier(time_t from, time_t to, uint32_t points) const {
+    uint32_t span = to > from ? to - from : 0;
+    uint32_t width = span / (points > 0 ? points : 1);
+
+    int tier = ROLLUP_MINUTE;
+    for (int t = ROLLUP_MINUTE; t < ROLLUP_TIER_COUNT; t++) {
+        if (TIER_CONFIG[t].bucketSeconds <= width) {
+            tier = t;
+        }
+    }
+
+    // Finer tiers have shorter retention; fall back until one covers the start
+    while (tier < ROLLUP_DAY) {
+        uint32_t oldest = getOldestEpoch((RollupTier)tier);
+        if (oldest == 0 || oldest <= (uint32_t)from) {
+            break;
+        }
+        tier++;
+    }
+
+    return (RollupTier)tier;
+}
+
+RingLog::Reader RollupStore::openRangeReader(RollupTier tier, time_t from, time_t to, uint32_t limit, uint32_t& count) const {
+    // Include the bucket that contains `from`
+    uint32_t seconds = TIER_CONFIG[tier].bucketSeconds;
+    uint32_t firstBucket = from > 0 ? (uint32_t)from - (uint32_t)from % seconds : 0;
+    return tiers[tier]->openRangeReader(firstBucket, to, limit, count);
+}
+
+RingLog::Reader RollupStore::openQuantileReader(time_t from, time_t to, uint32_t limit, uint32_t& count) const {
+    uint32_t seconds = TIER_CONFIG[ROLLUP_DAY].bucketSeconds;
+    uint32_t firstDay = from > 0 ? (uint32_t)from - (uint32_t)from % seconds : 0;
+    return quantiles->openRangeReader(firstDay, to, limit, count);
+}
+
+uint32_t RollupStore::getOldestEpoch(RollupTier tier) const {
+    RingLog::Reader reader = tiers[tier]->openReader();
+    RollupRecord record;
+    if (!reader.next(&record)) {
+        return 0;
+    }
+    return record.epoch;
+}
+
+uint32_t RollupStore::getBucketSeconds(RollupTier tier) {
+    return TIER_CONFIG[tier].bucketSeconds;
+}
+
+const char* RollupStore::getTierName(RollupTier tier) {
+    return TIER_CONFIG[tier].name;
+}
+
+bool RollupStore::parseTier(const char* name, RollupTier& tier) {
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        if (strcmp(name, TIER_CONFIG[t].name) == 0) {
+            tier = (RollupTier)t;
+            return true;
+        }
+    }
+    return false;
+}
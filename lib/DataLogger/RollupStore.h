@@ -0,0 +1,194 @@
+#ifndef ROLLUP_STORE_H
+#define ROLLUP_STORE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "RingLog.h"
+#include "QuantileSketch.h"
+
+/**
+ * @brief Aggregate of all readings that fell into one time bucket
+ *
+ * The record size is stored in each tier file's header, so a layout change
+ * reformats the tiers on the next boot instead of misreading them.
+ */
+struct RollupRecord {
+    uint32_t epoch;             // Start of the bucket (UTC aligned)
+    int16_t minCentiCelsius;
+    int16_t maxCentiCelsius;
+    int32_t sumCentiCelsius;    // A day at 1 Hz and 125 C is still ~1.1e9
+    uint32_t count;             // Wide enough for a day of 1 Hz readings
+    uint16_t flags;
+    uint16_t reserved;
+};
+
+enum RollupTier {
+    ROLLUP_MINUTE,
+    ROLLUP_HOUR,
+    ROLLUP_DAY,
+    ROLLUP_TIER_COUNT
+};
+
+/**
+ * @brief Downsampled min/max/avg/count history at minute, hour and day resolution
+ *
+ * Every tier is its own RingLog. The newest record of a tier is the bucket
+ * currently being filled. Readings are folded into it in RAM and written by
+ * flush(), with one small write per tier however many readings arrived, so
+ * long-range charts never have to touch raw readings. A bucket that closes
+ * is written before the next one is started.
+ *
+ * Each day also gets a QuantileRecord with its p50/p95/p99, kept in its own
+ * RingLog and written together with the rollup buckets. The quantiles are
+ * fed separately through addQuantile(), so they can see every sample rather
+ * than only the logged ones.
+ */
+class RollupStore {
+public:
+    /**
+     * @brief Construct a new Rollup Store object
+     *
+     * @param fs Filesystem holding the rollup files
+     */
+    RollupStore(fs::FS& fs);
+    ~RollupStore();
+
+    /**
+     * @brief Open all tier files and resume their open buckets
+     *
+     * @return true if all tiers are ready
+     * @return false if any tier file could not be opened
+     */
+    bool begin();
+
+    /**
+     * @brief Fold a reading into every tier
+     *
+     * Only writes to flash when the reading closes a bucket that hasn't been
+     * flushed since it last changed.
+     *
+     * @param epoch Unix timestamp of the reading
+     * @param centiCelsius Temperature in 1/100 °C
+     * @return true if all tiers were updated
+     */
+    bool add(uint32_t epoch, int16_t centiCelsius);
+
+    /**
+     * @brief Fold a reading into the quantile estimate of its day
+     *
+     * Only writes to flash when the reading starts a new day and the
+     * previous one hasn't been flushed since it last changed.
+     *
+     * @param epoch Unix timestamp of the reading
+     * @param centiCelsius Temperature in 1/100 °C
+     * @return true if the estimate was updated
+     */
+    bool addQuantile(uint32_t epoch, int16_t centiCelsius);
+
+    /**
+     * @brief Write the open buckets that changed since the last flush
+     *
+     * @return true if all tiers were written
+     */
+    bool flush();
+
+    /**
+     * @brief Copy the open bucket of every tier
+     *
+     * @param buckets Receives ROLLUP_TIER_COUNT buckets, count 0 for none
+     */
+    void getOpenBuckets(RollupRecord* buckets) const;
+
+    /**
+     * @brief Take over open buckets saved before a reset
+     *
+     * Call after begin(). A saved bucket replaces the newest one on flash if
+     * it is the same bucket or a newer one, and is written by the next flush().
+     *
+     * @param buckets ROLLUP_TIER_COUNT buckets as returned by getOpenBuckets()
+     */
+    void restoreOpenBuckets(const RollupRecord* buckets);
+
+    /**
+     * @brief Bytes written to all tier files since they were opened
+     */
+    uint32_t getBytesWritten() const;
+
+    /**
+     * @brief Bytes the tiers would have written had every reading been written through
+     */
+    uint32_t getWriteThroughBytes() const { return writeThroughBytes; }
+
+    /**
+     * @brief Pick the tier to answer a query with
+     *
+     * Chooses the coarsest tier that still yields about `points` buckets over
+     * the range, stepping to a coarser tier if that one doesn't reach back to
+     * `from`.
+     *
+     * @param from Start of the range
+     * @param to End of the range
+     * @param points Number of points the caller wants to plot
+     * @return RollupTier Tier to read from
+     */
+    RollupTier selectTier(time_t from, time_t to, uint32_t points) const;
+
+    /**
+     * @brief Open a reader over the buckets of one tier within a time range
+     *
+     * @param tier Tier to read
+     * @param from Oldest bucket start to include, 0 for no lower bound
+     * @param to Newest bucket start to include, 0 for no upper bound
+     * @param limit Maximum number of buckets, keeping the newest, 0 for no limit
+     * @param count Receives the number of buckets left to read
+     * @return RingLog::Reader Reader positioned at the first matching bucket
+     */
+    RingLog::Reader openRangeReader(RollupTier tier, time_t from, time_t to, uint32_t limit, uint32_t& count) const;
+
+    /**
+     * @brief Open a reader over the daily quantile records within a time range
+     *
+     * @param from Oldest day start to include, 0 for no lower bound
+     * @param to Newest day start to include, 0 for no upper bound
+     * @param limit Maximum number of days, keeping the newest, 0 for no limit
+     * @param count Receives the number of records left to read
+     * @return RingLog::Reader Reader returning QuantileRecords
+     */
+    RingLog::Reader openQuantileReader(time_t from, time_t to, uint32_t limit, uint32_t& count) const;
+
+    /**
+     * @brief Get the bucket width of a tier in seconds
+     */
+    static uint32_t getBucketSeconds(RollupTier tier);
+
+    /**
+     * @brief Get the name of a tier as used by the web API
+     */
+    static const char* getTierName(RollupTier tier);
+
+    /**
+     * @brief Parse a tier name as returned by getTierName
+     *
+     * @return true if name matched a tier
+     */
+    static bool parseTier(const char* name, RollupTier& tier);
+
+private:
+    RingLog* tiers[ROLLUP_TIER_COUNT];
+    RollupRecord current[ROLLUP_TIER_COUNT];  // Open bucket of each tier, count 0 if none
+    bool stored[ROLLUP_TIER_COUNT];           // Open bucket has been appended to its tier
+    bool dirty[ROLLUP_TIER_COUNT];            // Open bucket changed since it was last written
+    uint32_t writeThroughBytes;
+
+    RingLog* quantiles;
+    QuantileRecord currentQuantiles;    // Today's estimate, count 0 if none
+    bool quantilesStored;
+    bool quantilesDirty;
+
+    bool writeBucket(int tier);
+    bool writeQuantiles();
+
+    uint32_t getOldestEpoch(RollupTier tier) const;
+};
+
+#endif // ROLLUP_STORE_H
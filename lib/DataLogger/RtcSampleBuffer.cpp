@@ -0,0 +1,92 @@
+#include "RtcSampleBuffer.h"
+#include <esp_attr.h>
+#include <esp_rom_crc.h>
+#include <stddef.h>
+
+namespace {
+    const uint32_t MAGIC = 0x43545242;  // "BRTC"
+    const uint16_t VERSION = 2;  // 2: 32-bit rollup bucket counts
+
+    struct RtcState {
+        uint32_t magic;
+        uint32_t crc;               // Over everything below, up to the last buffered record
+        uint16_t version;
+        uint16_t count;
+        uint32_t baseSequence;
+        uint32_t lastLogTime;
+        RollupRecord buckets[ROLLUP_TIER_COUNT];
+        LogRecord records[RtcSampleBuffer::CAPACITY];
+    };
+
+    // Not touched by the startup code, so it keeps what the previous boot left
+    RTC_NOINIT_ATTR RtcState state;
+
+    uint32_t computeCrc() {
+        const uint8_t* body = (const uint8_t*)&state + offsetof(RtcState, version);
+        size_t length = offsetof(RtcState, records) - offsetof(RtcState, version)
+            + (size_t)state.count * sizeof(LogRecord);
+        return esp_rom_crc32_le(0, body, length);
+    }
+}
+
+bool RtcSampleBuffer::restore() {
+    bool valid = state.magic == MAGIC
+        && state.version == VERSION
+        && state.count <= CAPACITY
+        && state.crc == computeCrc();
+
+    if (!valid) {
+        memset(&state, 0, offsetof(RtcState, records));
+        state.magic = MAGIC;
+        state.version = VERSION;
+        seal();
+    }
+    return valid;
+}
+
+bool RtcSampleBuffer::push(const LogRecord& record) {
+    if (state.count >= CAPACITY) {
+        return false;
+    }
+    state.records[state.count] = record;
+    state.count++;
+    return true;
+}
+
+void RtcSampleBuffer::clear(uint32_t nextSequence) {
+    state.count = 0;
+    state.baseSequence = nextSequence;
+    seal();
+}
+
+void RtcSampleBuffer::seal() {
+    state.crc = computeCrc();
+}
+
+uint32_t RtcSampleBuffer::size() const {
+    return state.count;
+}
+
+const LogRecord* RtcSampleBuffer::getRecords() const {
+    return state.records;
+}
+
+uint32_t RtcSampleBuffer::getBaseSequence() const {
+    return state.baseSequence;
+}
+
+const RollupRecord* RtcSampleBuffer::getOpenBuckets() const {
+    return state.buckets;
+}
+
+void RtcSampleBuffer::setOpenBuckets(const RollupRecord* buckets) {
+    memcpy(state.buckets, buckets, sizeof(state.buckets));
+}
+
+uint32_t RtcSampleBuffer::getLastLogTime() const {
+    return state.lastLogTime;
+}
+
+void RtcSampleBuffer::setLastLogTime(uint32_t epoch) {
+    state.lastLogTime = epoch;
+}
@@ -0,0 +1,75 @@
+#ifndef RTC_SAMPLE_BUFFER_H
+#define RTC_SAMPLE_BUFFER_H
+
+#include <Arduino.h>
+#include "RingLog.h"
+#include "RollupStore.h"
+
+/**
+ * @brief Logged readings not yet written to flash, kept in RTC slow memory
+ *
+ * RTC slow memory keeps its contents across software and watchdog resets and
+ * deep sleep, but not across power loss. Next to the readings the buffer holds
+ * the logger state needed to replay them: the log sequence number the first
+ * reading will get, the open rollup buckets and the last logging time. A magic
+ * number and a CRC over everything tell contents left by an earlier boot from
+ * the garbage found after power-on.
+ *
+ * There is one buffer per device, shared by all instances. Changes are only
+ * protected by the CRC once seal() has been called.
+ */
+class RtcSampleBuffer {
+public:
+    static const uint32_t CAPACITY = 64;
+
+    /**
+     * @brief Check the contents left by the previous boot
+     *
+     * Invalid contents are discarded.
+     *
+     * @return true if the magic number and CRC matched
+     * @return false if the buffer was empty or corrupt, as after power-on
+     */
+    bool restore();
+
+    /**
+     * @brief Add a reading
+     *
+     * @return false if the buffer is full
+     */
+    bool push(const LogRecord& record);
+
+    /**
+     * @brief Drop all readings after they were written to flash
+     *
+     * @param nextSequence Log sequence number the next reading will get
+     */
+    void clear(uint32_t nextSequence);
+
+    /**
+     * @brief Recompute the CRC after the contents changed
+     */
+    void seal();
+
+    uint32_t size() const;
+    const LogRecord* getRecords() const;
+
+    /**
+     * @brief Log sequence number of the first buffered reading
+     *
+     * Tells how many of the readings reached flash if the reset came between
+     * writing a batch and clearing the buffer.
+     */
+    uint32_t getBaseSequence() const;
+
+    /**
+     * @brief Open bucket of every rollup tier, as of the last seal()
+     */
+    const RollupRecord* getOpenBuckets() const;
+    void setOpenBuckets(const RollupRecord* buckets);
+
+    uint32_t getLastLogTime() const;
+    void setLastLogTime(uint32_t epoch);
+};
+
+#endif // RTC_SAMPLE_BUFFER_H
@@ -0,0 +1,165 @@
+#include "SampleCache.h"
+#include <esp_heap_caps.h>
+
+SampleCache::SampleCache(uint32_t capacity)
+    : capacity(capacity > 0 ? capacity : 1)
+    , inPsram(false)
+    , storage(nullptr)
+    , added(0)
+    , count(0)
+    , oldestEpoch(0)
+    , newestEpoch(0)
+    , hits(0)
+    , misses(0)
+{
+    size_t bytes = (size_t)this->capacity * (sizeof(uint16_t) + sizeof(int16_t) + 2 * sizeof(uint8_t));
+    if (psramFound()) {
+        storage = (uint8_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        inPsram = storage != nullptr;
+    }
+    if (!storage) {
+        storage = (uint8_t*)heap_caps_malloc(bytes, MALLOC_CAP_8BIT);
+    }
+    if (!storage) {
+        Serial.println("Failed to allocate sample cache");
+        this->capacity = 0;
+        return;
+    }
+
+    // 16-bit arrays first so they stay aligned
+    epochDeltas = (uint16_t*)storage;
+    centiCelsius = (int16_t*)(epochDeltas + this->capacity);
+    sensorIds = (uint8_t*)(centiCelsius + this->capacity);
+    flags = sensorIds + this->capacity;
+}
+
+SampleCache::~SampleCache() {
+    heap_caps_free(storage);
+}
+
+void SampleCache::add(const LogRecord& record) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (capacity == 0) {
+        return;
+    }
+
+    if (count > 0 && (record.epoch < newestEpoch || record.epoch - newestEpoch > UINT16_MAX)) {
+        count = 0;
+    }
+
+    uint32_t s = slot(added);
+    if (count == 0) {
+        epochDeltas[s] = 0;
+        oldestEpoch = record.epoch;
+    } else {
+        epochDeltas[s] = record.epoch - newestEpoch;
+    }
+    centiCelsius[s] = record.centiCelsius;
+    sensorIds[s] = record.sensorId;
+    flags[s] = record.flags;
+    newestEpoch = record.epoch;
+    added++;
+
+    if (count < capacity) {
+        count++;
+    } else {
+        // The record after the overwritten one is now the oldest
+        oldestEpoch += epochDeltas[slot(oldestSeq())];
+    }
+}
+
+void SampleCache::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    count = 0;
+}
+
+uint32_t SampleCache::size() {
+    std::lock_guard<std::mutex> guard(lock);
+    return count;
+}
+
+bool SampleCache::findRange(uint32_t from, uint32_t to, uint32_t limit, uint32_t logSize, Cursor& cursor) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    // After the log shrinks the cache may hold records the log no longer has
+    uint32_t visible = count < logSize ? count : logSize;
+    if (visible == 0) {
+        misses++;
+        return false;
+    }
+    uint32_t start = added - visible;
+    uint32_t startEpoch = oldestEpoch;
+    for (uint32_t seq = oldestSeq() + 1; seq <= start; seq++) {
+        startEpoch += epochDeltas[slot(seq)];
+    }
+
+    // One pass over the deltas finds both ends of the range
+    uint32_t first = visible;
+    uint32_t end = visible;
+    uint32_t epoch = startEpoch;
+    for (uint32_t i = 0; i < visible; i++) {
+        if (i > 0) {
+            epoch += epochDeltas[slot(start + i)];
+        }
+        if (first == visible && epoch >= from) {
+            first = i;
+        }
+        if (to > 0 && epoch > to) {
+            end = i;
+            break;
+        }
+    }
+    if (first > end) {
+        first = end;
+    }
+
+    // Older records may exist in flash unless the cache holds the whole log,
+    // the range starts after the oldest cached record, or the limit is met
+    bool hit = visible >= logSize
+        || (from > startEpoch)
+        || (limit > 0 && end - first >= limit);
+    if (!hit) {
+        misses++;
+        return false;
+    }
+    hits++;
+
+    if (limit > 0 && end - first > limit) {
+        first = end - limit;
+    }
+
+    cursor.epoch = startEpoch;
+    for (uint32_t i = 1; i <= first && i < visible; i++) {
+        cursor.epoch += epochDeltas[slot(start + i)];
+    }
+    cursor.seq = start + first;
+    cursor.remaining = end - first;
+    return true;
+}
+
+size_t SampleCache::read(Cursor& cursor, LogRecord* records, size_t maxRecords) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    // Give up if the cursor's records were overwritten or the cache restarted
+    if (cursor.seq < oldestSeq() || cursor.seq > added) {
+        cursor.remaining = 0;
+        return 0;
+    }
+
+    size_t n = 0;
+    while (n < maxRecords && cursor.remaining > 0 && cursor.seq < added) {
+        uint32_t s = slot(cursor.seq);
+        LogRecord& record = records[n++];
+        record.epoch = cursor.epoch;
+        record.centiCelsius = centiCelsius[s];
+        record.sensorId = sensorIds[s];
+        record.flags = flags[s];
+
+        cursor.seq++;
+        cursor.remaining--;
+        if (cursor.seq < added) {
+            cursor.epoch += epochDeltas[slot(cursor.seq)];
+        }
+    }
+    return n;
+}
@@ -0,0 +1,109 @@
+#ifndef SAMPLE_CACHE_H
+#define SAMPLE_CACHE_H
+
+#include <Arduino.h>
+#include <mutex>
+#include "RingLog.h"
+
+/**
+ * @brief Fixed-size in-RAM copy of the newest log records
+ *
+ * Records are kept as a structure of arrays: the time since the previous
+ * record as a uint16_t, the temperature in 1/100 °C, the sensor id and the
+ * flags, 6 bytes per record instead of 8. Range scans only touch the epoch
+ * delta array. The arrays live in PSRAM when the board has it.
+ *
+ * Records are addressed by sequence number, the count of records added since
+ * the cache was cleared; the newest `capacity` of them are held. Adding is
+ * done by the logger, reads may come from other tasks.
+ */
+class SampleCache {
+public:
+    /**
+     * @brief Position of a reader in the cache
+     */
+    struct Cursor {
+        uint32_t seq = 0;       // Sequence number of the next record
+        uint32_t epoch = 0;     // Epoch of that record
+        uint32_t remaining = 0; // Records left to read
+    };
+
+    /**
+     * @brief Construct a new Sample Cache object
+     *
+     * @param capacity Number of records to keep
+     */
+    SampleCache(uint32_t capacity);
+    ~SampleCache();
+
+    SampleCache(const SampleCache&) = delete;
+    SampleCache& operator=(const SampleCache&) = delete;
+
+    /**
+     * @brief Add the newest log record
+     *
+     * A record older than the previous one, or more than 18 hours after it,
+     * can't be stored as a delta and restarts the cache from that record.
+     */
+    void add(const LogRecord& record);
+
+    /**
+     * @brief Drop all records
+     */
+    void clear();
+
+    /**
+     * @brief Find the records of a time range, if the cache can answer for it
+     *
+     * The cache answers when it holds the whole log, when the range starts
+     * after its oldest record, or when it holds at least `limit` matching
+     * records. Only the newest `logSize` records are considered, so a cache
+     * larger than the log never returns records the log has dropped. Counts a
+     * hit or a miss.
+     *
+     * @param from Oldest timestamp to include, 0 for no lower bound
+     * @param to Newest timestamp to include, 0 for no upper bound
+     * @param limit Maximum number of records, keeping the newest, 0 for no limit
+     * @param logSize Number of records in the log the cache mirrors
+     * @param cursor Receives the position of the first matching record
+     * @return true on a hit
+     * @return false if the range has to be read from flash
+     */
+    bool findRange(uint32_t from, uint32_t to, uint32_t limit, uint32_t logSize, Cursor& cursor);
+
+    /**
+     * @brief Read the next records at a cursor
+     *
+     * @return size_t Records read, fewer than asked if the cursor reached the
+     *         end or its records were overwritten in the meantime
+     */
+    size_t read(Cursor& cursor, LogRecord* records, size_t maxRecords);
+
+    uint32_t size();
+    uint32_t getCapacity() const { return capacity; }
+    bool isInPsram() const { return inPsram; }
+    uint32_t getHits() const { return hits; }
+    uint32_t getMisses() const { return misses; }
+
+private:
+    uint32_t capacity;
+    bool inPsram;
+    uint8_t* storage;           // One allocation holding the four arrays below
+    uint16_t* epochDeltas;      // Seconds since the previous record, 0 for the oldest ever added
+    int16_t* centiCelsius;
+    uint8_t* sensorIds;
+    uint8_t* flags;
+
+    uint32_t added;             // Sequence number of the next record
+    uint32_t count;
+    uint32_t oldestEpoch;
+    uint32_t newestEpoch;
+    uint32_t hits;
+    uint32_t misses;
+    std::mutex lock;
+
+    uint32_t oldestSeq() const { return added - count; }
+    uint32_t slot(uint32_t seq) const { return seq % capacity; }
+};
+
+#endif // SAMPLE_CACHE_H
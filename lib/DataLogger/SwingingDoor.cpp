@@ -0,0 +1,95 @@
+#include "SwingingDoor.h"
+
+SwingingDoor::SwingingDoor() : tolerance(0), heartbeat(0) {
+    reset();
+}
+
+void SwingingDoor::configure(float toleranceCentiCelsius, uint32_t heartbeatSeconds) {
+    // Leave room for rounding kept values to whole 1/100 °C
+    tolerance = toleranceCentiCelsius > 0.5f ? toleranceCentiCelsius - 0.5f : 0.0f;
+    heartbeat = heartbeatSeconds;
+    reset();
+}
+
+void SwingingDoor::reset() {
+    haveAnchor = false;
+    haveHeld = false;
+    upperSlope = INFINITY;
+    lowerSlope = -INFINITY;
+}
+
+bool SwingingDoor::add(const LogRecord& reading, LogRecord& kept) {
+    // Keep the first reading, and start over if the clock went backwards
+    if (!haveAnchor || reading.epoch < anchor.epoch) {
+        reset();
+        anchor = reading;
+        haveAnchor = true;
+        kept = reading;
+        return true;
+    }
+    if (reading.epoch == anchor.epoch) {
+        return false;
+    }
+
+    uint32_t elapsed = reading.epoch - anchor.epoch;
+    float change = (float)reading.centiCelsius - anchor.centiCelsius;
+    float upper = min(upperSlope, (change + tolerance) / elapsed);
+    float lower = max(lowerSlope, (change - tolerance) / elapsed);
+
+    if (lower <= upper && elapsed <= heartbeat) {
+        upperSlope = upper;
+        lowerSlope = lower;
+        held = reading;
+        haveHeld = true;
+        return false;
+    }
+
+    if (!haveHeld) {
+        // Heartbeat with nothing held since the last kept reading
+        reset();
+        anchor = reading;
+        haveAnchor = true;
+        kept = reading;
+        return true;
+    }
+
+    // Keep the last reading the doors still covered and swing them again from there
+    keepHeld(kept);
+    openDoors(reading);
+    return true;
+}
+
+bool SwingingDoor::flush(LogRecord& kept) {
+    if (!haveHeld) {
+        return false;
+    }
+    keepHeld(kept);
+    return true;
+}
+
+void SwingingDoor::keepHeld(LogRecord& kept) {
+    // The value is moved onto a line between the doors if needed, so the line
+    // from the anchor stays within the tolerance of every reading
+    uint32_t heldElapsed = held.epoch - anchor.epoch;
+    float slope = ((float)held.centiCelsius - anchor.centiCelsius) / heldElapsed;
+    slope = constrain(slope, lowerSlope, upperSlope);
+    held.centiCelsius = (int16_t)lroundf(anchor.centiCelsius + slope * heldElapsed);
+    kept = held;
+    anchor = held;
+    haveHeld = false;
+    upperSlope = INFINITY;
+    lowerSlope = -INFINITY;
+}
+
+void SwingingDoor::openDoors(const LogRecord& reading) {
+    if (reading.epoch <= anchor.epoch) {
+        return;
+    }
+
+    uint32_t elapsed = reading.epoch - anchor.epoch;
+    float change = (float)reading.centiCelsius - anchor.centiCelsius;
+    upperSlope = (change + tolerance) / elapsed;
+    lowerSlope = (change - tolerance) / elapsed;
+    held = reading;
+    haveHeld = true;
+}
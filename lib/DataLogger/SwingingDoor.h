@@ -0,0 +1,83 @@
+#ifndef SWINGING_DOOR_H
+#define SWINGING_DOOR_H
+
+#include <Arduino.h>
+#include "RingLog.h"
+
+/**
+ * @brief Swinging-door filter that keeps only the readings needed to
+ *        reconstruct a sensor's signal within a tolerance
+ *
+ * Starting from the last kept reading, two "doors" are swung through the
+ * readings that follow: the steepest line that stays within the tolerance
+ * below every reading and the flattest one that stays within it above. As
+ * long as the doors haven't crossed, a straight line from the kept reading
+ * passes within the tolerance of all of them. Once a reading makes them
+ * cross, the reading before it is kept and becomes the new starting point,
+ * its value nudged within the tolerance onto a line between the doors.
+ *
+ * Linear interpolation between kept readings is then off by at most the
+ * tolerance. A reading is also kept once the heartbeat has passed since the
+ * last one, so flat periods still show up in the log.
+ */
+class SwingingDoor {
+public:
+    SwingingDoor();
+
+    /**
+     * @brief Set the filter parameters, restarting the filter
+     *
+     * @param toleranceCentiCelsius Largest allowed reconstruction error in 1/100 °C
+     * @param heartbeatSeconds Longest time between kept readings
+     */
+    void configure(float toleranceCentiCelsius, uint32_t heartbeatSeconds);
+
+    /**
+     * @brief Forget the held reading, the next one is kept
+     */
+    void reset();
+
+    /**
+     * @brief Offer the next reading of the sensor
+     *
+     * @param reading Reading in time order
+     * @param kept Receives the reading to log, usually the previous one
+     *        offered and possibly moved by up to the tolerance
+     * @return true if kept should be logged
+     */
+    bool add(const LogRecord& reading, LogRecord& kept);
+
+    /**
+     * @brief Keep the held reading now, e.g. when the sensor stopped reporting
+     *
+     * @param kept Receives the held reading, moved as add() would
+     * @return true if a reading was held
+     */
+    bool flush(LogRecord& kept);
+
+    /**
+     * @brief Check if a reading is held back, which add() may still keep
+     */
+    bool isHolding() const { return haveHeld; }
+
+    /**
+     * @brief Get the time of the held reading, valid while isHolding()
+     */
+    uint32_t getHeldEpoch() const { return held.epoch; }
+
+private:
+    float tolerance;
+    uint32_t heartbeat;
+
+    bool haveAnchor;
+    LogRecord anchor;       // Last kept reading
+    bool haveHeld;
+    LogRecord held;         // Newest reading, kept if the next one breaks the doors
+    float upperSlope;       // Doors in 1/100 °C per second from the anchor
+    float lowerSlope;
+
+    void openDoors(const LogRecord& reading);
+    void keepHeld(LogRecord& kept);
+};
+
+#endif // SWINGING_DOOR_H
@@ -4,7 +4,21 @@
 
 #define ONE_WIRE_BUS 19
 
-SensorManager::SensorManager(uint8_t oneWirePin) : pin(oneWirePin), isInitialized(false) {
+SensorManager::SensorManager(uint8_t oneWirePin, unsigned long conversionIntervalMs)
+    : pin(oneWirePin)
+    , isInitialized(false)
+    , sensorCount(0)
+    , state(IDLE)
+    , conversionStartTime(0)
+    , conversionInterval(conversionIntervalMs)
+    , nextConversionTime(0)
+    , adaptiveResolution(false)
+    , maxResolution(12)
+    , resolution(12)
+    , stableReadings(0)
+    , resolutionPending(false)
+    , hasFixedResolutionProbe(false)
+{
     oneWire = new OneWire(pin);
     sensors = new DallasTemperature(oneWire);
 }
@@ -12,57 +26,197 @@ SensorManager::SensorManager(uint8_t oneWirePin) : pin(oneWirePin), isInitialize
 bool SensorManager::begin() {
     sensors->begin();
     
-    // Wait for first conversion
-    sensors->requestTemperatures();
-    delay(750);
-    
-    // Initialize cache
-    float temp = sensors->getTempCByIndex(0);
-    isInitialized = (temp != DEVICE_DISCONNECTED_C);
+    // Never block in requestTemperatures(), completion is polled in update()
+    sensors->setWaitForConversion(false);
+
+    // Resolution may change often in adaptive mode, keep it out of EEPROM
+    sensors->setAutoSaveScratchPad(false);
+
+    // Enumerate the bus once; reads then address each probe directly
+    sensorCount = 0;
+    uint8_t found = sensors->getDeviceCount();
+    for (uint8_t i = 0; i < found && sensorCount < MAX_SENSORS; i++) {
+        Probe& probe = probes[sensorCount];
+        if (!sensors->getAddress(probe.address, i)) {
+            continue;
+        }
+        probe.temperature = DEVICE_DISCONNECTED_C;
+        probe.readTime = 0;
+        probe.hasReading = false;
+        probe.lastConversionOk = false;
+        if (probe.address[0] == DS18S20MODEL) {
+            hasFixedResolutionProbe = true;
+        }
+        sensorCount++;
+    }
+    if (found > MAX_SENSORS) {
+        Serial.printf("Found %u sensors, only the first %u are used\n", found, MAX_SENSORS);
+    }
+
+    isInitialized = sensorCount > 0;
     if (isInitialized) {
-        lastTemperature = temp;
-        lastReadTime = millis();
+        applyResolution(maxResolution);
+        startConversion();
     }
     
     return isInitialized;
 }
 
-float SensorManager::getTemperature() {
+void SensorManager::update() {
     if (!isInitialized) {
-        Serial.println("Sensor not initialized!");
-        return DEVICE_DISCONNECTED_C;
+        return;
     }
-    
-    // Only request new temperature every 1 second
+
+    unsigned long now = millis();
+    if (state == CONVERTING) {
+        // Fall back to the datasheet conversion time in case the bus can't
+        // report completion (parasite power)
+        bool timedOut = now - conversionStartTime >= getConversionTime();
+        if (sensors->isConversionComplete() || timedOut) {
+            readConversion();
+        }
+    } else if ((long)(now - nextConversionTime) >= 0) {
+        startConversion();
+    }
+}
+
+void SensorManager::startConversion() {
+    // One broadcast conversion for every probe on the bus
+    sensors->requestTemperatures();
+    conversionStartTime = millis();
+    nextConversionTime = conversionStartTime + conversionInterval;
+    state = CONVERTING;
+}
+
+void SensorManager::planReading(unsigned long readyAt) {
+    nextConversionTime = readyAt - getConversionTime() - CONVERSION_MARGIN_MS;
+}
+
+void SensorManager::setReadingInterval(unsigned long intervalMs) {
+    conversionInterval = intervalMs;
+}
+
+unsigned long SensorManager::getConversionTime() const {
+    return DallasTemperature::millisToWaitForConversion(hasFixedResolutionProbe ? 12 : resolution);
+}
+
+void SensorManager::setResolutionPolicy(bool adaptive, uint8_t bits) {
+    adaptiveResolution = adaptive;
+    maxResolution = constrain(bits, MIN_RESOLUTION, 12);
+    stableReadings = 0;
+
+    // Takes effect right away in fixed mode, adaptive mode restarts from the top.
+    // The scratchpads can't be written mid-conversion, and the running one
+    // must still be timed by the resolution it was started with.
+    if (isInitialized && state == IDLE) {
+        applyResolution(maxResolution);
+    } else if (isInitialized) {
+        resolutionPending = true;
+    }
+}
+
+void SensorManager::applyResolution(uint8_t bits) {
+    // Per-address writes avoid the bus search done by the global setResolution()
+    for (uint8_t i = 0; i < sensorCount; i++) {
+        sensors->setResolution(probes[i].address, bits, true);
+    }
+    resolution = bits;
+}
+
+void SensorManager::adaptResolution(float maxChange) {
+    if (!adaptiveResolution) {
+        return;
+    }
+
+    if (maxChange >= FAST_CHANGE_C) {
+        // Track fast changes with quicker, coarser conversions
+        stableReadings = 0;
+        if (resolution > MIN_RESOLUTION) {
+            applyResolution(resolution - 1);
+        }
+    } else if (maxChange <= SLOW_CHANGE_C) {
+        if (++stableReadings >= STABLE_READINGS_TO_RAISE && resolution < maxResolution) {
+            stableReadings = 0;
+            applyResolution(resolution + 1);
+        }
+    } else {
+        stableReadings = 0;
+    }
+}
+
+void SensorManager::readConversion() {
+    state = IDLE;
+
     unsigned long now = millis();
-    if (now - lastReadTime >= 1000) {
-        sensors->requestTemperatures();
-        float temp = sensors->getTempCByIndex(0);
-        
-        if (temp == DEVICE_DISCONNECTED_C) {
-            Serial.println("Error: Sensor disconnected!");
-        } else {
-            lastTemperature = temp;
-            lastReadTime = now;
+    float maxChange = 0.0f;
+    for (uint8_t i = 0; i < sensorCount; i++) {
+        Probe& probe = probes[i];
+        float temp = sensors->getTempC(probe.address);
+
+        probe.lastConversionOk = (temp != DEVICE_DISCONNECTED_C);
+        if (!probe.lastConversionOk) {
+            Serial.printf("Error: Sensor %u disconnected!\n", i);
+            continue;
         }
+
+        if (probe.hasReading) {
+            maxChange = max(maxChange, fabsf(temp - probe.temperature));
+        }
+        probe.temperature = temp;
+        probe.readTime = now;
+        probe.hasReading = true;
+    }
+
+    // The bus is idle between conversions, so resolution changes go here
+    if (resolutionPending) {
+        resolutionPending = false;
+        applyResolution(maxResolution);
+    } else {
+        adaptResolution(maxChange);
+    }
+}
+
+float SensorManager::getTemperature(uint8_t index) {
+    if (!isInitialized || index >= sensorCount) {
+        Serial.println("Sensor not initialized!");
+        return DEVICE_DISCONNECTED_C;
     }
     
-    return lastTemperature;
+    return probes[index].temperature;
 }
 
-bool SensorManager::isSensorWorking() {
-    if (!isInitialized) {
+unsigned long SensorManager::getReadingAge(uint8_t index) const {
+    if (index >= sensorCount || !probes[index].hasReading) {
+        return ULONG_MAX;
+    }
+    return millis() - probes[index].readTime;
+}
+
+bool SensorManager::isSensorWorking(uint8_t index) {
+    if (!isInitialized || index >= sensorCount) {
         Serial.println("Sensor not initialized!");
         return false;
     }
     
-    sensors->requestTemperatures();
-    float temp = sensors->getTempCByIndex(0);
-    bool working = (temp != DEVICE_DISCONNECTED_C);
+    const Probe& probe = probes[index];
+    unsigned long staleAfter = STALE_INTERVALS * conversionInterval + getConversionTime();
+    bool working = probe.hasReading && probe.lastConversionOk && getReadingAge(index) <= staleAfter;
     
     if (!working) {
-        Serial.println("Error: Sensor not working!");
+        Serial.printf("Error: Sensor %u not working!\n", index);
     }
     
     return working;
 }
+
+String SensorManager::getAddressString(uint8_t index) const {
+    if (index >= sensorCount) {
+        return String();
+    }
+
+    char hex[17];
+    for (uint8_t i = 0; i < 8; i++) {
+        snprintf(hex + i * 2, 3, "%02X", probes[index].address[i]);
+    }
+    return String(hex);
+}
@@ -5,51 +5,173 @@
 #include <DallasTemperature.h>
 
 /**
- * @brief Manages the DS18B20 temperature sensor operations
+ * @brief Manages the DS18B20 temperature sensors on a OneWire bus
  * 
  * This class handles the initialization, reading, and management of the DS18B20
- * temperature sensor. It provides methods to get temperature readings and check
- * sensor status.
+ * temperature sensors. It provides methods to get temperature readings and check
+ * sensor status. Sensors are identified by their index in the ROM table built at
+ * begin(); index 0 is the primary sensor.
+ * 
+ * Conversions run asynchronously: update() starts one broadcast conversion for
+ * all sensors, returns immediately and reads each sensor by its cached address
+ * once the conversion is complete. Readers always get the last good value
+ * without touching the bus.
+ * 
+ * Conversion time depends on resolution (94 ms at 9 bits up to 750 ms at 12
+ * bits). Conversions are started so they finish just before the time passed to
+ * planReading(). In adaptive mode the resolution drops while readings change
+ * quickly and climbs back towards the configured maximum once they settle.
  */
 class SensorManager {
 public:
+    static const uint8_t MAX_SENSORS = 8;
+
     /**
      * @brief Construct a new Sensor Manager object
      * 
-     * @param oneWirePin GPIO pin number where the DS18B20 sensor is connected
+     * @param oneWirePin GPIO pin number where the DS18B20 sensors are connected
+     * @param conversionIntervalMs Time between the start of two conversions in milliseconds
+     */
+    SensorManager(uint8_t oneWirePin, unsigned long conversionIntervalMs = 1000);
+
+    /**
+     * @brief Set how sensor resolution is chosen
+     * 
+     * @param adaptive true to adapt resolution to how fast readings change
+     * @param maxResolution Fixed resolution, or the upper bound in adaptive mode (9-12 bits)
+     */
+    void setResolutionPolicy(bool adaptive, uint8_t maxResolution);
+
+    /**
+     * @brief Set the time between readings used when none is planned explicitly
+     * 
+     * @param intervalMs Interval in milliseconds
+     */
+    void setReadingInterval(unsigned long intervalMs);
+
+    /**
+     * @brief Schedule the next conversion to complete just before a given time
+     * 
+     * @param readyAt millis() timestamp at which a fresh reading is needed
+     */
+    void planReading(unsigned long readyAt);
+
+    /**
+     * @brief Get the resolution currently used by the sensors
+     * 
+     * @return uint8_t Resolution in bits
+     */
+    uint8_t getResolution() const { return resolution; }
+
+    /**
+     * @brief Get the time one conversion takes at the current resolution
+     * 
+     * @return unsigned long Conversion time in milliseconds
      */
-    SensorManager(uint8_t oneWirePin);
+    unsigned long getConversionTime() const;
 
     /**
-     * @brief Initialize the temperature sensor
+     * @brief Discover the sensors on the bus and start the first conversion
      * 
-     * @return true if initialization was successful
+     * @return true if at least one sensor was found
      * @return false if initialization failed
      */
     bool begin();
 
     /**
-     * @brief Get the current temperature reading
+     * @brief Advance the conversion state machine
      * 
+     * This method should be called regularly in the main loop. It never waits
+     * for a conversion to finish.
+     */
+    void update();
+
+    /**
+     * @brief Get the number of sensors found at begin()
+     * 
+     * @return uint8_t Number of sensors in the ROM table
+     */
+    uint8_t getSensorCount() const { return sensorCount; }
+
+    /**
+     * @brief Get the last good temperature reading of a sensor
+     * 
+     * @param index Sensor index, 0 for the primary sensor
      * @return float Temperature in Celsius
      */
-    float getTemperature();
+    float getTemperature(uint8_t index = 0);
+
+    /**
+     * @brief Get the time since the last good reading of a sensor
+     * 
+     * @param index Sensor index, 0 for the primary sensor
+     * @return unsigned long Age in milliseconds, ULONG_MAX if there is none yet
+     */
+    unsigned long getReadingAge(uint8_t index = 0) const;
 
     /**
-     * @brief Check if the sensor is properly connected and functioning
+     * @brief Check if a sensor is properly connected and functioning
      * 
-     * @return true if sensor is working
+     * @param index Sensor index, 0 for the primary sensor
+     * @return true if the last conversion succeeded and its value is at most
+     *         two reading intervals plus a conversion time old
      * @return false if sensor is not responding
      */
-    bool isSensorWorking();
+    bool isSensorWorking(uint8_t index = 0);
+
+    /**
+     * @brief Get the 64-bit ROM address of a sensor as a hex string
+     * 
+     * @param index Sensor index
+     * @return String 16 hex digits, empty if the index is out of range
+     */
+    String getAddressString(uint8_t index) const;
 
 private:
+    enum ConversionState { IDLE, CONVERTING };
+
+    // A reading is no longer reported as working once this many conversions
+    // in a row are overdue, so the limit follows the reading interval
+    static const uint8_t STALE_INTERVALS = 2;
+
+    // Margin between the expected end of a conversion and the planned reading time
+    static const unsigned long CONVERSION_MARGIN_MS = 20;
+
+    // Adaptive resolution thresholds, as change between consecutive readings
+    static constexpr float FAST_CHANGE_C = 1.0f;
+    static constexpr float SLOW_CHANGE_C = 0.5f;
+    static const uint8_t STABLE_READINGS_TO_RAISE = 3;
+    static const uint8_t MIN_RESOLUTION = 9;
+
+    struct Probe {
+        DeviceAddress address;
+        float temperature;        // Cache for the last valid temperature reading
+        unsigned long readTime;   // Timestamp of the last temperature reading
+        bool hasReading;
+        bool lastConversionOk;
+    };
+
     OneWire* oneWire;
     DallasTemperature* sensors;
     uint8_t pin;
     bool isInitialized;
-    float lastTemperature;  // Cache for the last valid temperature reading
-    unsigned long lastReadTime;  // Timestamp of the last temperature reading
+    Probe probes[MAX_SENSORS];
+    uint8_t sensorCount;
+    ConversionState state;
+    unsigned long conversionStartTime;
+    unsigned long conversionInterval;
+    unsigned long nextConversionTime;
+    bool adaptiveResolution;
+    uint8_t maxResolution;
+    uint8_t resolution;
+    uint8_t stableReadings;
+    bool resolutionPending;        // Policy changed mid-conversion, apply maxResolution when idle
+    bool hasFixedResolutionProbe;  // DS18S20 always converts at 12-bit speed
+
+    void startConversion();
+    void readConversion();
+    void applyResolution(uint8_t bits);
+    void adaptResolution(float maxChange);
 };
 
 #endif // SENSOR_MANAGER_H
@@ -0,0 +1,94 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Lock-free ring buffer for exactly one producer and one consumer
+ *
+ * The producer only writes `head` and the consumer only writes `tail`, so
+ * push() and pop() never block and need no critical section. Each index is
+ * published with release ordering after the slot it covers has been written
+ * or read, and loaded with acquire ordering by the other side.
+ *
+ * One slot is never filled so that a full ring can be told apart from an empty
+ * one; the ring holds up to Capacity - 1 items.
+ *
+ * @tparam T Item type, copied in and out by value
+ * @tparam Capacity Number of slots, must be a power of two
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : head(0), tail(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * @brief Add an item (producer side only)
+     *
+     * @param item Item to copy into the ring
+     * @return true if the item was queued
+     * @return false if the ring is full
+     */
+    bool push(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t next = (h + 1) & MASK;
+        if (next == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        slots[h] = item;
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest item (consumer side only)
+     *
+     * @param item Receives the item
+     * @return true if an item was removed
+     * @return false if the ring is empty
+     */
+    bool pop(T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots[t];
+        tail.store((t + 1) & MASK, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Number of queued items
+     *
+     * Exact when called from the producer or the consumer, a snapshot otherwise.
+     */
+    size_t size() const {
+        return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) & MASK;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    /**
+     * @brief Maximum number of items the ring can hold at once
+     */
+    static constexpr size_t capacity() { return Capacity - 1; }
+
+private:
+    static const size_t MASK = Capacity - 1;
+
+    // Producer and consumer indices live on separate cache lines on hosts that
+    // have them, so the two sides don't keep invalidating each other
+    alignas(32) std::atomic<size_t> head;  // Next slot to write
+    alignas(32) std::atomic<size_t> tail;  // Next slot to read
+    T slots[Capacity];
+};
+
+#endif // SPSC_RING_H
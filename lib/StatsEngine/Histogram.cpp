@@ -0,0 +1,46 @@
+#include "Histogram.h"
+
+Histogram::Histogram(const Layout& layout)
+    : layout(layout)
+{
+    if (this->layout.widthCentiCelsius == 0) {
+        this->layout.widthCentiCelsius = 1;
+    }
+    if (this->layout.bins == 0) {
+        this->layout.bins = 1;
+    } else if (this->layout.bins > MAX_BINS) {
+        this->layout.bins = MAX_BINS;
+    }
+    counts = new uint32_t[this->layout.bins];
+    clear();
+}
+
+Histogram::~Histogram() {
+    delete[] counts;
+}
+
+void Histogram::add(int16_t centiCelsius) {
+    if (centiCelsius < layout.lowCentiCelsius) {
+        below++;
+        return;
+    }
+
+    uint32_t bin = (uint32_t)(centiCelsius - layout.lowCentiCelsius) / layout.widthCentiCelsius;
+    if (bin >= layout.bins) {
+        above++;
+        return;
+    }
+    counts[bin]++;
+}
+
+void Histogram::clear() {
+    memset(counts, 0, layout.bins * sizeof(uint32_t));
+    below = 0;
+    above = 0;
+}
+
+void Histogram::getCounts(uint32_t* counts, uint32_t& below, uint32_t& above) const {
+    memcpy(counts, this->counts, layout.bins * sizeof(uint32_t));
+    below = this->below;
+    above = this->above;
+}
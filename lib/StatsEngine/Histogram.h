@@ -0,0 +1,62 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Counts of readings in fixed-width temperature bins
+ *
+ * Bins cover [low, low + bins * width). Readings outside the range are
+ * counted as below or above rather than dropped, so the counts always add
+ * up to the readings seen. Adding a reading is a single division.
+ */
+class Histogram {
+public:
+    static const uint16_t MAX_BINS = 512;
+
+    struct Layout {
+        int16_t lowCentiCelsius;    // Lower edge of the first bin
+        uint16_t widthCentiCelsius; // Width of each bin
+        uint16_t bins;              // Number of bins, at most MAX_BINS
+    };
+
+    /**
+     * @brief Construct a new Histogram object with all counts at zero
+     */
+    explicit Histogram(const Layout& layout);
+    ~Histogram();
+
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    /**
+     * @brief Count a reading
+     *
+     * @param centiCelsius Temperature in 1/100 °C
+     */
+    void add(int16_t centiCelsius);
+
+    /**
+     * @brief Set all counts back to zero
+     */
+    void clear();
+
+    /**
+     * @brief Copy out the counts
+     *
+     * @param counts Receives one count per bin, lowest bin first
+     * @param below Receives the readings under the first bin
+     * @param above Receives the readings past the last bin
+     */
+    void getCounts(uint32_t* counts, uint32_t& below, uint32_t& above) const;
+
+    const Layout& getLayout() const { return layout; }
+
+private:
+    Layout layout;
+    uint32_t* counts;
+    uint32_t below;
+    uint32_t above;
+};
+
+#endif // HISTOGRAM_H
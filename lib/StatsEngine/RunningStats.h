@@ -0,0 +1,74 @@
+#ifndef RUNNING_STATS_H
+#define RUNNING_STATS_H
+
+#include <Arduino.h>
+#include <math.h>
+
+/**
+ * @brief Count, mean, variance and extremes of a stream of readings in O(1)
+ *
+ * Mean and variance use Welford's update, which stays accurate over millions
+ * of readings where summing squares would cancel out. Accumulators are double
+ * for the same reason; an update costs a handful of soft-float operations.
+ */
+class RunningStats {
+public:
+    RunningStats() { reset(); }
+
+    void reset() {
+        count = 0;
+        mean = 0.0;
+        m2 = 0.0;
+        min = 0.0f;
+        max = 0.0f;
+        minEpoch = 0;
+        maxEpoch = 0;
+    }
+
+    /**
+     * @brief Add a reading
+     *
+     * @param value Temperature in Celsius
+     * @param epoch Unix time of the reading, kept with a new minimum or maximum
+     */
+    void add(float value, uint32_t epoch) {
+        count++;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+
+        if (count == 1 || value < min) {
+            min = value;
+            minEpoch = epoch;
+        }
+        if (count == 1 || value > max) {
+            max = value;
+            maxEpoch = epoch;
+        }
+    }
+
+    uint32_t getCount() const { return count; }
+    float getMean() const { return (float)mean; }
+    float getMin() const { return min; }
+    float getMax() const { return max; }
+    uint32_t getMinEpoch() const { return minEpoch; }
+    uint32_t getMaxEpoch() const { return maxEpoch; }
+
+    /**
+     * @brief Sample variance, 0 with fewer than two readings
+     */
+    float getVariance() const { return count > 1 ? (float)(m2 / (count - 1)) : 0.0f; }
+
+    float getStdDev() const { return sqrtf(getVariance()); }
+
+private:
+    uint32_t count;
+    double mean;
+    double m2;          // Sum of squared differences from the mean
+    float min;
+    float max;
+    uint32_t minEpoch;
+    uint32_t maxEpoch;
+};
+
+#endif // RUNNING_STATS_H
@@ -0,0 +1,130 @@
+#include "StatsEngine.h"
+
+StatsEngine::StatsEngine(uint16_t windowCapacity)
+    : resetEpoch(0)
+    , windowCapacity(windowCapacity)
+    , windowCount(0)
+    , histogramLayout{-1000, 50, 100}
+{
+    for (WindowStats*& sensor : windows) {
+        sensor = nullptr;
+    }
+    for (Histogram*& sensor : histograms) {
+        sensor = nullptr;
+    }
+}
+
+StatsEngine::~StatsEngine() {
+    for (WindowStats* sensor : windows) {
+        delete sensor;
+    }
+    for (Histogram* sensor : histograms) {
+        delete sensor;
+    }
+}
+
+void StatsEngine::add(uint8_t sensorId, float temperature, uint32_t epoch) {
+    if (sensorId >= SensorManager::MAX_SENSORS) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    sinceBoot[sensorId].add(temperature, epoch);
+    sinceReset[sensorId].add(temperature, epoch);
+
+    if (!windows[sensorId]) {
+        windows[sensorId] = new WindowStats(windowCapacity);
+        windows[sensorId]->setWindows(windowSeconds, windowCount);
+    }
+    int16_t centiCelsius = (int16_t)lroundf(temperature * 100.0f);
+    windows[sensorId]->add(epoch, centiCelsius);
+
+    if (!histograms[sensorId]) {
+        histograms[sensorId] = new Histogram(histogramLayout);
+    }
+    histograms[sensorId]->add(centiCelsius);
+}
+
+void StatsEngine::reset(uint32_t epoch) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (uint8_t sensor = 0; sensor < SensorManager::MAX_SENSORS; sensor++) {
+        sinceReset[sensor].reset();
+        if (histograms[sensor]) {
+            histograms[sensor]->clear();
+        }
+    }
+    resetEpoch = epoch;
+}
+
+bool StatsEngine::getStats(uint8_t sensorId, RunningStats& boot, RunningStats& reset) const {
+    if (sensorId >= SensorManager::MAX_SENSORS) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    boot = sinceBoot[sensorId];
+    reset = sinceReset[sensorId];
+    return true;
+}
+
+uint32_t StatsEngine::getResetEpoch() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return resetEpoch;
+}
+
+void StatsEngine::setWindows(const uint32_t* seconds, uint8_t count) {
+    std::lock_guard<std::mutex> guard(lock);
+    windowCount = count < WindowStats::MAX_WINDOWS ? count : WindowStats::MAX_WINDOWS;
+    memcpy(windowSeconds, seconds, windowCount * sizeof(uint32_t));
+    for (WindowStats* sensor : windows) {
+        if (sensor) {
+            sensor->setWindows(windowSeconds, windowCount);
+        }
+    }
+}
+
+uint8_t StatsEngine::getWindows(uint32_t* seconds) const {
+    std::lock_guard<std::mutex> guard(lock);
+    memcpy(seconds, windowSeconds, windowCount * sizeof(uint32_t));
+    return windowCount;
+}
+
+bool StatsEngine::getWindow(uint8_t sensorId, uint32_t seconds, WindowStats::Result& result) const {
+    if (sensorId >= SensorManager::MAX_SENSORS) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    return windows[sensorId] && windows[sensorId]->get(seconds, result);
+}
+
+void StatsEngine::setHistogram(const Histogram::Layout& layout) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (layout.lowCentiCelsius == histogramLayout.lowCentiCelsius &&
+        layout.widthCentiCelsius == histogramLayout.widthCentiCelsius &&
+        layout.bins == histogramLayout.bins) {
+        return;
+    }
+
+    // Counts can't be moved between differently sized bins, so start over
+    histogramLayout = layout;
+    for (Histogram*& sensor : histograms) {
+        delete sensor;
+        sensor = nullptr;
+    }
+}
+
+bool StatsEngine::getHistogram(uint8_t sensorId, Histogram::Layout& layout, uint32_t* counts,
+                               uint32_t& below, uint32_t& above) const {
+    if (sensorId >= SensorManager::MAX_SENSORS) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (!histograms[sensorId]) {
+        return false;
+    }
+    layout = histograms[sensorId]->getLayout();
+    histograms[sensorId]->getCounts(counts, below, above);
+    return true;
+}
@@ -0,0 +1,121 @@
+#ifndef STATS_ENGINE_H
+#define STATS_ENGINE_H
+
+#include <Arduino.h>
+#include <mutex>
+#include "RunningStats.h"
+#include "WindowStats.h"
+#include "Histogram.h"
+#include "SensorManager.h"
+
+/**
+ * @brief Per-sensor statistics, updated with every reading
+ *
+ * Keeps two sets of RunningStats per sensor: one since boot and one since
+ * the last reset(), WindowStats over the configured sliding windows and a
+ * Histogram of the readings since the last reset.
+ * Readings are added from loop() while the web server reads the statistics
+ * from the network task, so access is locked.
+ */
+class StatsEngine {
+public:
+    /**
+     * @brief Construct a new Stats Engine object
+     *
+     * @param windowCapacity Readings kept per sensor for the sliding windows;
+     *        the ring is allocated once a sensor's first reading arrives
+     */
+    StatsEngine(uint16_t windowCapacity = 1024);
+    ~StatsEngine();
+
+    /**
+     * @brief Add a reading to the statistics of its sensor
+     *
+     * Readings of sensors beyond SensorManager::MAX_SENSORS are ignored.
+     *
+     * @param sensorId Index of the sensor that produced the reading
+     * @param temperature Temperature in Celsius
+     * @param epoch Unix time of the reading
+     */
+    void add(uint8_t sensorId, float temperature, uint32_t epoch);
+
+    /**
+     * @brief Start the since-reset statistics and histograms of all sensors over
+     *
+     * @param epoch Unix time of the reset
+     */
+    void reset(uint32_t epoch);
+
+    /**
+     * @brief Copy out the statistics of one sensor
+     *
+     * @param sensorId Index of the sensor
+     * @param sinceBoot Receives the statistics since boot
+     * @param sinceReset Receives the statistics since the last reset
+     * @return false if the sensor id is out of range
+     */
+    bool getStats(uint8_t sensorId, RunningStats& sinceBoot, RunningStats& sinceReset) const;
+
+    /**
+     * @brief Get the time of the last reset, 0 if there was none since boot
+     */
+    uint32_t getResetEpoch() const;
+
+    /**
+     * @brief Replace the sliding windows of all sensors
+     *
+     * @param seconds Window lengths
+     * @param count Number of windows, at most WindowStats::MAX_WINDOWS are used
+     */
+    void setWindows(const uint32_t* seconds, uint8_t count);
+
+    /**
+     * @brief Get the configured window lengths
+     *
+     * @param seconds Receives up to WindowStats::MAX_WINDOWS lengths
+     * @return uint8_t Number of windows
+     */
+    uint8_t getWindows(uint32_t* seconds) const;
+
+    /**
+     * @brief Get one sensor's statistics over one of the configured windows
+     *
+     * @param sensorId Index of the sensor
+     * @param seconds Window length
+     * @param result Receives the statistics
+     * @return false if the window isn't configured or has no readings of the sensor
+     */
+    bool getWindow(uint8_t sensorId, uint32_t seconds, WindowStats::Result& result) const;
+
+    /**
+     * @brief Replace the histogram bins of all sensors, clearing their counts
+     */
+    void setHistogram(const Histogram::Layout& layout);
+
+    /**
+     * @brief Copy out one sensor's histogram
+     *
+     * @param sensorId Index of the sensor
+     * @param layout Receives the bins the counts belong to
+     * @param counts Receives the bin counts, room for Histogram::MAX_BINS
+     * @param below Receives the readings under the first bin
+     * @param above Receives the readings past the last bin
+     * @return false if the sensor has no readings since the bins were set
+     */
+    bool getHistogram(uint8_t sensorId, Histogram::Layout& layout, uint32_t* counts,
+                      uint32_t& below, uint32_t& above) const;
+
+private:
+    RunningStats sinceBoot[SensorManager::MAX_SENSORS];
+    RunningStats sinceReset[SensorManager::MAX_SENSORS];
+    uint32_t resetEpoch;
+    uint16_t windowCapacity;
+    WindowStats* windows[SensorManager::MAX_SENSORS];
+    uint32_t windowSeconds[WindowStats::MAX_WINDOWS];
+    uint8_t windowCount;
+    Histogram* histograms[SensorManager::MAX_SENSORS];
+    Histogram::Layout histogramLayout;
+    mutable std::mutex lock;
+};
+
+#endif // STATS_ENGINE_H
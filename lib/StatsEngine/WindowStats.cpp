@@ -0,0 +1,138 @@
+#include "WindowStats.h"
+
+WindowStats::WindowStats(uint16_t capacity)
+    : capacity(capacity > 0 ? capacity : 1)
+    , next(0)
+    , windowCount(0)
+{
+    epochs = new uint32_t[this->capacity];
+    values = new int16_t[this->capacity];
+    for (Window& window : windows) {
+        window.minimum.slots = nullptr;
+        window.maximum.slots = nullptr;
+    }
+}
+
+WindowStats::~WindowStats() {
+    for (Window& window : windows) {
+        delete[] window.minimum.slots;
+        delete[] window.maximum.slots;
+    }
+    delete[] epochs;
+    delete[] values;
+}
+
+void WindowStats::setWindows(const uint32_t* seconds, uint8_t count) {
+    windowCount = count < MAX_WINDOWS ? count : MAX_WINDOWS;
+
+    uint32_t oldest = next > capacity ? next - capacity : 0;
+    for (uint8_t i = 0; i < MAX_WINDOWS; i++) {
+        Window& window = windows[i];
+        if (i >= windowCount) {
+            delete[] window.minimum.slots;
+            delete[] window.maximum.slots;
+            window.minimum.slots = nullptr;
+            window.maximum.slots = nullptr;
+            continue;
+        }
+
+        if (!window.minimum.slots) {
+            window.minimum.slots = new uint16_t[capacity];
+            window.maximum.slots = new uint16_t[capacity];
+        }
+        window.seconds = seconds[i];
+        window.start = oldest;
+        window.sum = 0;
+        window.minimum.head = window.minimum.tail = 0;
+        window.maximum.head = window.maximum.tail = 0;
+        window.full = false;
+        window.truncated = false;
+    }
+
+    // Replay the kept readings so the new windows don't start out empty
+    for (uint32_t sequence = oldest; sequence < next; sequence++) {
+        for (uint8_t i = 0; i < windowCount; i++) {
+            expire(windows[i], epochs[sequence % capacity], sequence);
+            push(windows[i], sequence);
+        }
+    }
+}
+
+void WindowStats::add(uint32_t epoch, int16_t centiCelsius) {
+    // Expire first, the oldest reading's slot is about to be reused
+    for (uint8_t i = 0; i < windowCount; i++) {
+        expire(windows[i], epoch, next);
+    }
+
+    uint16_t slot = next % capacity;
+    epochs[slot] = epoch;
+    values[slot] = centiCelsius;
+    for (uint8_t i = 0; i < windowCount; i++) {
+        push(windows[i], next);
+    }
+    next++;
+}
+
+void WindowStats::expire(Window& window, uint32_t newest, uint32_t end) {
+    while (window.start < end) {
+        uint16_t slot = window.start % capacity;
+        bool aged = epochs[slot] + window.seconds <= newest;
+        bool evicted = end - window.start >= capacity;
+        if (!aged && !evicted) {
+            break;
+        }
+        window.full = window.full || aged;
+        window.truncated = !aged;
+
+        window.sum -= values[slot];
+        // Fronts are the oldest entries, so only they can hold this slot
+        if (!window.minimum.empty() && window.minimum.slots[window.minimum.head % capacity] == slot) {
+            window.minimum.head++;
+        }
+        if (!window.maximum.empty() && window.maximum.slots[window.maximum.head % capacity] == slot) {
+            window.maximum.head++;
+        }
+        window.start++;
+    }
+}
+
+void WindowStats::push(Window& window, uint32_t sequence) {
+    uint16_t slot = sequence % capacity;
+    int16_t value = values[slot];
+    window.sum += value;
+
+    // Drop readings that can no longer be the extreme while this one is in the window
+    SlotDeque& minimum = window.minimum;
+    while (!minimum.empty() && values[minimum.slots[(minimum.tail - 1) % capacity]] >= value) {
+        minimum.tail--;
+    }
+    minimum.slots[minimum.tail++ % capacity] = slot;
+
+    SlotDeque& maximum = window.maximum;
+    while (!maximum.empty() && values[maximum.slots[(maximum.tail - 1) % capacity]] <= value) {
+        maximum.tail--;
+    }
+    maximum.slots[maximum.tail++ % capacity] = slot;
+}
+
+bool WindowStats::get(uint32_t seconds, Result& result) const {
+    for (uint8_t i = 0; i < windowCount; i++) {
+        const Window& window = windows[i];
+        if (window.seconds != seconds) {
+            continue;
+        }
+
+        result.count = next - window.start;
+        if (result.count == 0) {
+            return false;
+        }
+        result.minCentiCelsius = values[window.minimum.slots[window.minimum.head % capacity]];
+        result.maxCentiCelsius = values[window.maximum.slots[window.maximum.head % capacity]];
+        result.meanCentiCelsius = (float)window.sum / result.count;
+        result.spanSeconds = epochs[(next - 1) % capacity] - epochs[window.start % capacity];
+        result.full = window.full;
+        result.truncated = window.truncated;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,100 @@
+#ifndef WINDOW_STATS_H
+#define WINDOW_STATS_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Min, max and mean of one sensor over several sliding time windows
+ *
+ * The newest readings are kept in a ring shared by all windows. Each window
+ * keeps the index of its oldest reading, a running sum, and two monotonic
+ * deques of ring slots: values only increase from front to back in the
+ * minimum deque and only decrease in the maximum deque, so the front is the
+ * window's minimum or maximum. A reading is pushed and expired at most once
+ * per deque, which makes an update amortized O(1) per window.
+ *
+ * A window ends at the newest reading. When it holds more readings than the
+ * ring, the oldest are dropped early and the window is marked truncated.
+ */
+class WindowStats {
+public:
+    static const uint8_t MAX_WINDOWS = 4;
+
+    struct Result {
+        uint32_t count;
+        int16_t minCentiCelsius;
+        int16_t maxCentiCelsius;
+        float meanCentiCelsius;
+        uint32_t spanSeconds;   // From the oldest to the newest reading in the window
+        bool full;              // Readings older than the window have been seen
+        bool truncated;         // The ring is too small for the window
+    };
+
+    /**
+     * @brief Construct a new Window Stats object without windows
+     *
+     * @param capacity Readings kept, which bounds the readings per window
+     */
+    explicit WindowStats(uint16_t capacity);
+    ~WindowStats();
+
+    WindowStats(const WindowStats&) = delete;
+    WindowStats& operator=(const WindowStats&) = delete;
+
+    /**
+     * @brief Replace the windows, filling them from the readings kept
+     *
+     * @param seconds Window lengths
+     * @param count Number of windows, at most MAX_WINDOWS are used
+     */
+    void setWindows(const uint32_t* seconds, uint8_t count);
+
+    /**
+     * @brief Add a reading to every window
+     *
+     * @param epoch Unix time of the reading
+     * @param centiCelsius Temperature in 1/100 °C
+     */
+    void add(uint32_t epoch, int16_t centiCelsius);
+
+    /**
+     * @brief Get the statistics of one window
+     *
+     * @param seconds Length of a window passed to setWindows()
+     * @param result Receives the statistics
+     * @return false if there is no such window or it has no readings
+     */
+    bool get(uint32_t seconds, Result& result) const;
+
+private:
+    // Ring slots in insertion order; holds at most capacity entries
+    struct SlotDeque {
+        uint16_t* slots;
+        uint32_t head;
+        uint32_t tail;
+
+        bool empty() const { return head == tail; }
+    };
+
+    struct Window {
+        uint32_t seconds;
+        uint32_t start;     // Sequence number of the oldest reading in the window
+        int64_t sum;        // Sum of the window's readings in 1/100 °C
+        SlotDeque minimum;
+        SlotDeque maximum;
+        bool full;
+        bool truncated;
+    };
+
+    uint16_t capacity;
+    uint32_t* epochs;
+    int16_t* values;
+    uint32_t next;          // Sequence number of the next reading, slot next % capacity
+    Window windows[MAX_WINDOWS];
+    uint8_t windowCount;
+
+    void expire(Window& window, uint32_t newest, uint32_t end);
+    void push(Window& window, uint32_t sequence);
+};
+
+#endif // WINDOW_STATS_H
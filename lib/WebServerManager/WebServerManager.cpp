@@ -2,13 +2,21 @@
 #include <ESPAsyncWebServer.h>
 #include "SensorManager.h"
 #include <ArduinoJson.h>
+#include <algorithm>
 
 // AsyncWebServer server(80);
 // AsyncWebSocket ws("/ws");
 
-WebServerManager::WebServerManager(uint16_t port) : port(port), isInAPMode(false) {
+WebServerManager::WebServerManager(uint16_t port) : port(port), isInAPMode(false), dataLogger(nullptr), sensorManager(nullptr),
+    statsEngine(nullptr), alertEngine(nullptr), anomalyDetector(nullptr),
+    droppedFrames(0), coalescedFrames(0), nextSeq(1),
+    snapshotsSent(0), firstChartReports(0), firstChartTotalMs(0), firstChartMaxMs(0) {
+    for (PendingReading& reading : pendingReadings) {
+        reading.pending = false;
+    }
     server = new AsyncWebServer(port);
     ws = new AsyncWebSocket("/ws");
+    events = new AsyncEventSource("/api/events");
 }
 
 bool WebServerManager::begin() {
@@ -23,6 +31,12 @@ bool WebServerManager::begin() {
     });
     server->addHandler(ws);
 
+    // Server-Sent Events carry the same readings for clients that prefer plain HTTP
+    events->onConnect([this](AsyncEventSourceClient* client) {
+        replayEvents(client);
+    });
+    server->addHandler(events);
+
     setupRoutes();
     server->begin();
     return true;
@@ -79,12 +93,12 @@ void WebServerManager::setupRoutes() {
     });
 
     // Export temperature data
-    server->on("/api/data/export", HTTP_GET, [](AsyncWebServerRequest *request) {
-        if (!SPIFFS.exists("/temperature_log.json")) {
+    server->on("/api/data/export", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!dataLogger || dataLogger->getEntryCount() == 0) {
             request->send(404, "application/json", "{\"status\":\"error\",\"message\":\"No data found\"}");
             return;
         }
-        request->send(SPIFFS, "/temperature_log.json", "application/json");
+        sendHistory(request);
     });
 
     // Reset WiFi configuration
@@ -128,20 +142,65 @@ void WebServerManager::setupRoutes() {
                 return;
             }
             
-            int loggingInterval = doc["loggingInterval"];
-            int tempUpdateInterval = doc["tempUpdateInterval"];
-            int maxLogEntries = doc["maxLogEntries"];
+            SystemSettings settings;
+            settings.loggingInterval = doc["loggingInterval"];
+            settings.tempUpdateInterval = doc["tempUpdateInterval"];
+            settings.maxLogEntries = doc["maxLogEntries"];
+
+            // Resolution, commit and compression fields are optional, older clients keep the defaults
+            const char* resolutionMode = doc["resolutionMode"] | "fixed";
+            settings.adaptiveResolution = strcmp(resolutionMode, "adaptive") == 0;
+            settings.sensorResolution = doc["sensorResolution"] | settings.sensorResolution;
+            settings.commitRecords = doc["commitRecords"] | settings.commitRecords;
+            settings.commitSeconds = doc["commitSeconds"] | settings.commitSeconds;
+            const char* compressionMode = doc["compressionMode"] | "off";
+            settings.compression = strcmp(compressionMode, "swinging-door") == 0;
+            settings.compressionTolerance = doc["compressionTolerance"] | settings.compressionTolerance;
+            settings.heartbeatSeconds = doc["heartbeatSeconds"] | settings.heartbeatSeconds;
+            settings.histogramMin = doc["histogramMin"] | settings.histogramMin;
+            settings.histogramMax = doc["histogramMax"] | settings.histogramMax;
+            settings.histogramBinWidth = doc["histogramBinWidth"] | settings.histogramBinWidth;
+            settings.anomalySpan = doc["anomalySpan"] | settings.anomalySpan;
+            settings.anomalyThreshold = doc["anomalyThreshold"] | settings.anomalyThreshold;
+            bool windowsValid = true;
+            if (doc["statsWindows"].is<JsonArrayConst>()) {
+                JsonArrayConst windows = doc["statsWindows"];
+                windowsValid = windows.size() <= WindowStats::MAX_WINDOWS;
+                settings.statsWindowCount = 0;
+                for (JsonVariantConst window : windows) {
+                    uint32_t seconds = window | 0;
+                    if (seconds < 60 || seconds > 86400 || settings.statsWindowCount == WindowStats::MAX_WINDOWS) {
+                        windowsValid = false;
+                        break;
+                    }
+                    settings.statsWindows[settings.statsWindowCount++] = seconds;
+                }
+            }
             
             // Validate ranges
-            if (tempUpdateInterval < 1 || tempUpdateInterval > 60 ||
-                loggingInterval < 5 || loggingInterval > 3600 ||
-                maxLogEntries < 100 || maxLogEntries > 10000) {
+            if (settings.tempUpdateInterval < 1 || settings.tempUpdateInterval > 60 ||
+                settings.loggingInterval < 5 || settings.loggingInterval > 3600 ||
+                settings.maxLogEntries < 100 || settings.maxLogEntries > 10000 ||
+                settings.sensorResolution < 9 || settings.sensorResolution > 12 ||
+                settings.commitRecords < 1 || settings.commitRecords > (int)DataLogger::MAX_COMMIT_RECORDS ||
+                settings.commitSeconds < 1 || settings.commitSeconds > 3600 ||
+                settings.compressionTolerance < 0.01f || settings.compressionTolerance > 5.0f ||
+                settings.heartbeatSeconds < 60 || settings.heartbeatSeconds > 86400 ||
+                !windowsValid ||
+                settings.histogramMin < -55.0f || settings.histogramMax > 125.0f ||
+                settings.histogramMin >= settings.histogramMax ||
+                settings.histogramBinWidth < 0.05f || settings.histogramBinWidth > 10.0f ||
+                ceilf((settings.histogramMax - settings.histogramMin) / settings.histogramBinWidth) > Histogram::MAX_BINS ||
+                settings.anomalySpan < 10 || settings.anomalySpan > 10000 ||
+                settings.anomalyThreshold < 2.0f || settings.anomalyThreshold > 10.0f ||
+                (!settings.compression && strcmp(compressionMode, "off") != 0) ||
+                (!settings.adaptiveResolution && strcmp(resolutionMode, "fixed") != 0)) {
                 request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Values out of valid range\"}");
                 return;
             }
             
             if (systemSettingsCallback) {
-                systemSettingsCallback(loggingInterval, tempUpdateInterval, maxLogEntries);
+                systemSettingsCallback(settings);
                 request->send(200, "application/json", "{\"status\":\"success\"}");
             } else {
                 request->send(500, "application/json", "{\"status\":\"error\",\"message\":\"Settings handler not configured\"}");
@@ -153,29 +212,720 @@ void WebServerManager::setupRoutes() {
     server->on("/api/system/settings", HTTP_GET, [](AsyncWebServerRequest *request) {
         JsonDocument doc;
         File file = SPIFFS.open("/settings.json", "r");
-        if (!file) {
-            doc["loggingInterval"] = 300; // Default 5 minutes
-            doc["tempUpdateInterval"] = 5; // Default 5 seconds
-            doc["maxLogEntries"] = 1000;  // Default 1000 entries
-        } else {
+        if (file) {
             deserializeJson(doc, file);
             file.close();
         }
+
+        // Fill in defaults for anything the stored file doesn't have yet
+        SystemSettings defaults;
+        if (!doc.containsKey("loggingInterval")) doc["loggingInterval"] = defaults.loggingInterval;
+        if (!doc.containsKey("tempUpdateInterval")) doc["tempUpdateInterval"] = defaults.tempUpdateInterval;
+        if (!doc.containsKey("maxLogEntries")) doc["maxLogEntries"] = defaults.maxLogEntries;
+        if (!doc.containsKey("resolutionMode")) doc["resolutionMode"] = defaults.adaptiveResolution ? "adaptive" : "fixed";
+        if (!doc.containsKey("sensorResolution")) doc["sensorResolution"] = defaults.sensorResolution;
+        if (!doc.containsKey("commitRecords")) doc["commitRecords"] = defaults.commitRecords;
+        if (!doc.containsKey("commitSeconds")) doc["commitSeconds"] = defaults.commitSeconds;
+        if (!doc.containsKey("compressionMode")) doc["compressionMode"] = defaults.compression ? "swinging-door" : "off";
+        if (!doc.containsKey("compressionTolerance")) doc["compressionTolerance"] = defaults.compressionTolerance;
+        if (!doc.containsKey("heartbeatSeconds")) doc["heartbeatSeconds"] = defaults.heartbeatSeconds;
+        if (!doc.containsKey("statsWindows")) {
+            JsonArray windows = doc["statsWindows"].to<JsonArray>();
+            for (uint8_t i = 0; i < defaults.statsWindowCount; i++) {
+                windows.add(defaults.statsWindows[i]);
+            }
+        }
+        if (!doc.containsKey("histogramMin")) doc["histogramMin"] = defaults.histogramMin;
+        if (!doc.containsKey("histogramMax")) doc["histogramMax"] = defaults.histogramMax;
+        if (!doc.containsKey("histogramBinWidth")) doc["histogramBinWidth"] = defaults.histogramBinWidth;
+        if (!doc.containsKey("anomalySpan")) doc["anomalySpan"] = defaults.anomalySpan;
+        if (!doc.containsKey("anomalyThreshold")) doc["anomalyThreshold"] = defaults.anomalyThreshold;
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // Alert rules with their current state, and what evaluating them costs
+    server->on("/api/alerts", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!alertEngine) {
+            request->send(404, "application/json", "{\"error\":\"Alerts not available\"}");
+            return;
+        }
+
+        sendAlerts(request);
+    });
+
+    // Replace the alert rules
+    server->on("/api/alerts", HTTP_POST,
+        [](AsyncWebServerRequest* request) {},
+        [](AsyncWebServerRequest* request, String filename, size_t index, uint8_t *data, size_t len, bool final) {},
+        [this](AsyncWebServerRequest* request, uint8_t *data, size_t len, size_t index, size_t total) {
+            if (len == 0) {
+                request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Empty request body\"}");
+                return;
+            }
+
+            JsonDocument doc;
+            if (deserializeJson(doc, data, len) || !doc["rules"].is<JsonArrayConst>()) {
+                request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Invalid JSON\"}");
+                return;
+            }
+
+            AlertRule rules[AlertEngine::MAX_RULES];
+            uint8_t count;
+            if (!parseAlertRules(doc["rules"], rules, count)) {
+                request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Invalid alert rule\"}");
+                return;
+            }
+
+            if (alertRulesCallback) {
+                alertRulesCallback(rules, count);
+                request->send(200, "application/json", "{\"status\":\"success\"}");
+            } else {
+                request->send(500, "application/json", "{\"status\":\"error\",\"message\":\"Alert handler not configured\"}");
+            }
+        }
+    );
+
+    // List the sensors found on the OneWire bus
+    server->on("/api/sensors", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        JsonDocument doc;
+        JsonArray list = doc["sensors"].to<JsonArray>();
+        uint8_t count = sensorManager ? sensorManager->getSensorCount() : 0;
+        for (uint8_t i = 0; i < count; i++) {
+            JsonObject sensor = list.add<JsonObject>();
+            sensor["id"] = i;
+            sensor["address"] = sensorManager->getAddressString(i);
+            unsigned long age = sensorManager->getReadingAge(i);
+            if (age != ULONG_MAX) {
+                sensor["temperature"] = sensorManager->getTemperature(i);
+                sensor["ageMs"] = age;
+            }
+        }
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // Start the since-reset statistics over. Registered before /api/stats,
+    // which would otherwise match its subpaths too
+    server->on("/api/stats/reset", HTTP_POST, [this](AsyncWebServerRequest *request) {
+        if (!statsEngine) {
+            request->send(404, "application/json", "{\"error\":\"Statistics not available\"}");
+            return;
+        }
+
+        statsEngine->reset((uint32_t)time(nullptr));
+        request->send(200, "application/json", "{\"status\":\"success\"}");
+    });
+
+    // Bin counts of the readings since reset, optionally for one sensor with ?sensor=<id>
+    server->on("/api/stats/histogram", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!statsEngine) {
+            request->send(404, "application/json", "{\"error\":\"Statistics not available\"}");
+            return;
+        }
+
+        sendHistogram(request);
+    });
+
+    // Running statistics of every sensor that has readings, since boot and since
+    // reset, or over one of the sliding windows with ?window=<seconds>
+    server->on("/api/stats", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!statsEngine) {
+            request->send(404, "application/json", "{\"error\":\"Statistics not available\"}");
+            return;
+        }
+
+        if (request->hasParam("window")) {
+            sendWindowStats(request, strtoul(request->getParam("window")->value().c_str(), nullptr, 10));
+            return;
+        }
+
+        JsonDocument doc;
+        doc["resetEpoch"] = statsEngine->getResetEpoch();
+        uint32_t seconds[WindowStats::MAX_WINDOWS];
+        uint8_t windowCount = statsEngine->getWindows(seconds);
+        JsonArray windows = doc["windows"].to<JsonArray>();
+        for (uint8_t i = 0; i < windowCount; i++) {
+            windows.add(seconds[i]);
+        }
+        JsonArray list = doc["sensors"].to<JsonArray>();
+        for (uint8_t i = 0; i < SensorManager::MAX_SENSORS; i++) {
+            RunningStats sinceBoot;
+            RunningStats sinceReset;
+            if (!statsEngine->getStats(i, sinceBoot, sinceReset) || sinceBoot.getCount() == 0) {
+                continue;
+            }
+            JsonObject sensor = list.add<JsonObject>();
+            sensor["sensor"] = i;
+            writeStats(sensor["sinceBoot"].to<JsonObject>(), sinceBoot);
+            writeStats(sensor["sinceReset"].to<JsonObject>(), sinceReset);
+
+            AnomalyDetector::State baseline;
+            if (anomalyDetector && anomalyDetector->getState(i, baseline)) {
+                JsonObject anomaly = sensor["anomaly"].to<JsonObject>();
+                anomaly["mean"] = baseline.mean;
+                anomaly["fastMean"] = baseline.fastMean;
+                anomaly["stdDev"] = baseline.stdDev;
+                anomaly["outliers"] = baseline.outliers;
+                anomaly["shifts"] = baseline.shifts;
+            }
+        }
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // WebSocket fan-out counters, to spot clients that can't keep up
+    server->on("/api/system/websocket", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        JsonDocument doc;
+        doc["clients"] = ws->count();
+        doc["eventClients"] = events->count();
+        doc["droppedFrames"] = droppedFrames;
+        doc["coalescedFrames"] = coalescedFrames;
+        doc["snapshotsSent"] = snapshotsSent;
+        doc["firstChartReports"] = firstChartReports;
+        doc["firstChartAvgMs"] = firstChartReports > 0 ? firstChartTotalMs / firstChartReports : 0;
+        doc["firstChartMaxMs"] = firstChartMaxMs;
+        {
+            std::lock_guard<std::mutex> lock(binaryClientsLock);
+            doc["binaryClients"] = binaryClients.size();
+        }
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // Hit rate of the RAM cache in front of the log
+    server->on("/api/system/cache", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!dataLogger) {
+            request->send(404, "application/json", "{\"error\":\"Data logger not available\"}");
+            return;
+        }
+
+        std::shared_ptr<SampleCache> cache = dataLogger->getCache();
+        JsonDocument doc;
+        doc["capacity"] = cache->getCapacity();
+        doc["size"] = cache->size();
+        doc["psram"] = cache->isInPsram();
+        doc["hits"] = cache->getHits();
+        doc["misses"] = cache->getMisses();
         String response;
         serializeJson(doc, response);
         request->send(200, "application/json", response);
     });
 
+    // Retention of the raw log, what the last change to it cost, and how much
+    // flash writing group commits and compression save
+    server->on("/api/system/storage", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!dataLogger) {
+            request->send(404, "application/json", "{\"error\":\"Data logger not available\"}");
+            return;
+        }
+
+        JsonDocument doc;
+        doc["entries"] = dataLogger->getEntryCount();
+        doc["maxEntries"] = dataLogger->getMaxEntries();
+        doc["lastResizeMicros"] = dataLogger->getLastResizeMicros();
+        uint32_t samples = dataLogger->getSamplesLogged();
+        doc["samplesLogged"] = samples;
+        doc["samplesOffered"] = dataLogger->getSamplesOffered();
+        doc["compression"] = dataLogger->isCompressionEnabled();
+        doc["pending"] = dataLogger->getPendingCount();
+        doc["flushes"] = dataLogger->getFlushCount();
+        doc["flashBytes"] = dataLogger->getFlashBytesWritten();
+        doc["writeThroughBytes"] = dataLogger->getWriteThroughBytes();
+        doc["bytesPerSample"] = samples > 0 ? (float)dataLogger->getFlashBytesWritten() / samples : 0;
+        doc["writeThroughBytesPerSample"] = samples > 0 ? (float)dataLogger->getWriteThroughBytes() / samples : 0;
+        const BlockArchive& archive = dataLogger->getArchive();
+        doc["archiveBlocks"] = archive.getBlockCount();
+        doc["archiveCapacity"] = archive.getCapacity();
+        doc["archiveBytesPerSample"] = archive.getStoredReadings() > 0
+            ? (float)archive.getStoredBlocks() * sizeof(TemperatureBlock) / archive.getStoredReadings() : 0;
+        String response;
+        serializeJson(doc, response);
+        request->send(200, "application/json", response);
+    });
+
+    // Raw readings from the compressed archive, for ranges older than the ring log keeps
+    server->on("/api/temperature/archive", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!dataLogger) {
+            request->send(404, "application/json", "{\"error\":\"No history found\"}");
+            return;
+        }
+
+        sendArchive(request);
+    });
+
+    // Daily p50/p95/p99 for compliance reports
+    server->on("/api/temperature/percentiles", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!dataLogger) {
+            request->send(404, "application/json", "{\"error\":\"No history found\"}");
+            return;
+        }
+
+        sendQuantiles(request);
+    });
+
+    // Downsampled min/max/avg history from the coarsest tier that fits the range
+    server->on("/api/temperature/rollups", HTTP_GET, [this](AsyncWebServerRequest *request) {
+        if (!dataLogger) {
+            request->send(404, "application/json", "{\"error\":\"No history found\"}");
+            return;
+        }
+
+        sendRollups(request);
+    });
+
     server->on("/api/temperature/history", HTTP_GET, [this](AsyncWebServerRequest *request) {
-        if (!SPIFFS.exists("/temperature_log.json")) {
+        if (!dataLogger) {
             request->send(404, "application/json", "{\"error\":\"No history found\"}");
             return;
         }
         
-        request->send(SPIFFS, "/temperature_log.json", "application/json");
+        sendHistory(request);
     });
 }
 
+void WebServerManager::sendHistory(AsyncWebServerRequest* request) {
+    time_t from = 0;
+    time_t to = 0;
+    uint32_t limit = 0;
+    if (request->hasParam("from")) {
+        from = strtoul(request->getParam("from")->value().c_str(), nullptr, 10);
+    }
+    if (request->hasParam("to")) {
+        to = strtoul(request->getParam("to")->value().c_str(), nullptr, 10);
+    }
+    if (request->hasParam("limit")) {
+        limit = strtoul(request->getParam("limit")->value().c_str(), nullptr, 10);
+    }
+
+    std::shared_ptr<HistoryStream> stream = std::make_shared<HistoryStream>();
+    if (request->hasParam("step")) {
+        // Readings on a regular grid, interpolated between the logged ones;
+        // one sensor at a time, the primary one unless asked otherwise
+        stream->step = strtoul(request->getParam("step")->value().c_str(), nullptr, 10);
+        stream->maxGap = dataLogger->getMaxGap();
+        stream->gridEpoch = from;
+        stream->sensorFilter = 0;
+    }
+    if (request->hasParam("sensor")) {
+        stream->sensorFilter = request->getParam("sensor")->value().toInt();
+    }
+
+    // Sensors are logged together each interval, so widen the window to
+    // still return about `limit` readings of the requested one
+    if (stream->sensorFilter >= 0 && sensorManager && sensorManager->getSensorCount() > 1) {
+        limit *= sensorManager->getSensorCount();
+    }
+
+    // Recent ranges are served from RAM, anything older from flash
+    if (dataLogger->findCachedRange(from, to, limit, stream->cursor)) {
+        stream->cache = dataLogger->getCache();
+        stream->remaining = stream->cursor.remaining;
+    } else {
+        stream->reader = dataLogger->openRangeReader(from, to, limit, stream->remaining);
+        if (!stream->reader.isValid()) {
+            request->send(500, "application/json", "{\"error\":\"Failed to open log file\"}");
+            return;
+        }
+    }
+    stream->total = dataLogger->getEntryCount();
+    sendStream(request, stream);
+}
+
+void WebServerManager::sendRollups(AsyncWebServerRequest* request) {
+    time_t to = time(nullptr);
+    time_t from = 0;
+    uint32_t points = 100;
+    if (request->hasParam("to")) {
+        to = strtoul(request->getParam("to")->value().c_str(), nullptr, 10);
+    }
+    if (request->hasParam("from")) {
+        from = strtoul(request->getParam("from")->value().c_str(), nullptr, 10);
+    } else {
+        from = to - 24 * 3600;  // Default to the last day
+    }
+    if (request->hasParam("points")) {
+        points = strtoul(request->getParam("points")->value().c_str(), nullptr, 10);
+    }
+
+    const RollupStore& store = dataLogger->getRollups();
+    RollupTier tier;
+    if (!request->hasParam("tier") ||
+        !RollupStore::parseTier(request->getParam("tier")->value().c_str(), tier)) {
+        tier = store.selectTier(from, to, points);
+    }
+
+    std::shared_ptr<HistoryStream> stream = std::make_shared<HistoryStream>();
+    stream->rollups = true;
+    stream->tier = tier;
+    stream->reader = store.openRangeReader(tier, from, to, 0, stream->remaining);
+    if (!stream->reader.isValid()) {
+        request->send(500, "application/json", "{\"error\":\"Failed to open rollup file\"}");
+        return;
+    }
+    stream->total = stream->remaining;
+    sendStream(request, stream);
+}
+
+void WebServerManager::sendArchive(AsyncWebServerRequest* request) {
+    std::shared_ptr<HistoryStream> stream = std::make_shared<HistoryStream>();
+    stream->archive = true;
+    if (request->hasParam("from")) {
+        stream->from = strtoul(request->getParam("from")->value().c_str(), nullptr, 10);
+    }
+    if (request->hasParam("to")) {
+        stream->to = strtoul(request->getParam("to")->value().c_str(), nullptr, 10);
+    }
+    if (request->hasParam("sensor")) {
+        stream->sensorFilter = request->getParam("sensor")->value().toInt();
+    }
+
+    stream->reader = dataLogger->getArchive().openRangeReader(stream->from, stream->to, stream->remaining);
+    if (!stream->reader.isValid()) {
+        request->send(500, "application/json", "{\"error\":\"Failed to open archive file\"}");
+        return;
+    }
+    stream->total = stream->remaining;
+    sendStream(request, stream);
+}
+
+void WebServerManager::sendQuantiles(AsyncWebServerRequest* request) {
+    time_t from = 0;
+    time_t to = 0;
+    uint32_t limit = 0;
+    if (request->hasParam("from")) {
+        from = strtoul(request->getParam("from")->value().c_str(), nullptr, 10);
+    }
+    if (request->hasParam("to")) {
+        to = strtoul(request->getParam("to")->value().c_str(), nullptr, 10);
+    }
+    if (request->hasParam("limit")) {
+        limit = strtoul(request->getParam("limit")->value().c_str(), nullptr, 10);
+    }
+
+    std::shared_ptr<HistoryStream> stream = std::make_shared<HistoryStream>();
+    stream->quantiles = true;
+    stream->reader = dataLogger->getRollups().openQuantileReader(from, to, limit, stream->remaining);
+    if (!stream->reader.isValid()) {
+        request->send(500, "application/json", "{\"error\":\"Failed to open quantile file\"}");
+        return;
+    }
+    stream->total = stream->remaining;
+    sendStream(request, stream);
+}
+
+void WebServerManager::sendWindowStats(AsyncWebServerRequest* request, uint32_t window) {
+    uint32_t seconds[WindowStats::MAX_WINDOWS];
+    uint8_t windowCount = statsEngine->getWindows(seconds);
+    bool configured = false;
+    for (uint8_t i = 0; i < windowCount; i++) {
+        configured = configured || seconds[i] == window;
+    }
+    if (!configured) {
+        request->send(400, "application/json", "{\"error\":\"Window not configured, see statsWindows\"}");
+        return;
+    }
+
+    JsonDocument doc;
+    doc["window"] = window;
+    JsonArray list = doc["sensors"].to<JsonArray>();
+    for (uint8_t i = 0; i < SensorManager::MAX_SENSORS; i++) {
+        WindowStats::Result result;
+        if (!statsEngine->getWindow(i, window, result)) {
+            continue;
+        }
+        JsonObject sensor = list.add<JsonObject>();
+        sensor["sensor"] = i;
+        sensor["count"] = result.count;
+        sensor["min"] = result.minCentiCelsius / 100.0f;
+        sensor["max"] = result.maxCentiCelsius / 100.0f;
+        sensor["mean"] = result.meanCentiCelsius / 100.0f;
+        sensor["spanSeconds"] = result.spanSeconds;
+        sensor["full"] = result.full;
+        sensor["truncated"] = result.truncated;
+    }
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+void WebServerManager::sendHistogram(AsyncWebServerRequest* request) {
+    int sensorFilter = -1;
+    if (request->hasParam("sensor")) {
+        sensorFilter = request->getParam("sensor")->value().toInt();
+    }
+
+    // Counts are copied out one sensor at a time and printed as they are, a
+    // JsonDocument of several full histograms wouldn't fit the heap
+    std::unique_ptr<uint32_t[]> counts(new uint32_t[Histogram::MAX_BINS]);
+    AsyncResponseStream* response = request->beginResponseStream("application/json");
+    response->printf("{\"resetEpoch\":%lu,\"sensors\":[", (unsigned long)statsEngine->getResetEpoch());
+    bool first = true;
+    for (uint8_t i = 0; i < SensorManager::MAX_SENSORS; i++) {
+        Histogram::Layout layout;
+        uint32_t below;
+        uint32_t above;
+        if ((sensorFilter >= 0 && sensorFilter != i) ||
+            !statsEngine->getHistogram(i, layout, counts.get(), below, above)) {
+            continue;
+        }
+
+        response->printf("%s{\"sensor\":%u,\"min\":%.2f,\"binWidth\":%.2f,\"below\":%lu,\"above\":%lu,\"counts\":[",
+                         first ? "" : ",", i, layout.lowCentiCelsius / 100.0f, layout.widthCentiCelsius / 100.0f,
+                         (unsigned long)below, (unsigned long)above);
+        for (uint16_t bin = 0; bin < layout.bins; bin++) {
+            response->printf(bin == 0 ? "%lu" : ",%lu", (unsigned long)counts[bin]);
+        }
+        response->print("]}");
+        first = false;
+    }
+    response->print("]}");
+    request->send(response);
+}
+
+void WebServerManager::sendAlerts(AsyncWebServerRequest* request) {
+    AlertRule rules[AlertEngine::MAX_RULES];
+    AlertEngine::State states[AlertEngine::MAX_RULES];
+    uint8_t count = alertEngine->getRules(rules, states);
+
+    JsonDocument doc;
+    JsonArray list = doc["rules"].to<JsonArray>();
+    for (uint8_t i = 0; i < count; i++) {
+        JsonObject rule = list.add<JsonObject>();
+        rule["type"] = AlertEngine::getTypeName(rules[i].type);
+        rule["sensor"] = rules[i].sensorId;
+        rule["threshold"] = rules[i].threshold;
+        rule["hysteresis"] = rules[i].hysteresis;
+        rule["holdSeconds"] = rules[i].holdSeconds;
+        rule["active"] = states[i].active;
+        rule["value"] = states[i].value;
+        if (states[i].active) {
+            rule["raisedEpoch"] = states[i].raisedEpoch;
+        }
+    }
+    JsonObject evaluation = doc["evaluation"].to<JsonObject>();
+    evaluation["count"] = alertEngine->getEvaluations();
+    evaluation["meanUs"] = alertEngine->getMeanEvaluationMicros();
+    evaluation["maxUs"] = alertEngine->getMaxEvaluationMicros();
+
+    String response;
+    serializeJson(doc, response);
+    request->send(200, "application/json", response);
+}
+
+bool WebServerManager::parseAlertRules(JsonArrayConst list, AlertRule* rules, uint8_t& count) {
+    if (list.size() > AlertEngine::MAX_RULES) {
+        return false;
+    }
+
+    count = 0;
+    for (JsonObjectConst entry : list) {
+        AlertRule& rule = rules[count];
+        if (!AlertEngine::parseType(entry["type"] | "", rule.type)) {
+            return false;
+        }
+        int sensor = entry["sensor"] | 0;
+        rule.threshold = entry["threshold"] | NAN;
+        rule.hysteresis = entry["hysteresis"] | 0.0f;
+        long hold = entry["holdSeconds"] | 0L;
+        if (sensor < 0 || sensor >= SensorManager::MAX_SENSORS ||
+            isnan(rule.threshold) || rule.hysteresis < 0.0f || rule.hysteresis > 10.0f ||
+            hold < 0 || hold > 86400) {
+            return false;
+        }
+        rule.sensorId = sensor;
+        rule.holdSeconds = hold;
+
+        // Thresholds are °C, °C/min or seconds depending on the type
+        switch (rule.type) {
+            case ALERT_ABOVE:
+            case ALERT_BELOW:
+                if (rule.threshold < -55.0f || rule.threshold > 125.0f) {
+                    return false;
+                }
+                break;
+            case ALERT_RATE:
+                if (rule.threshold == 0.0f || fabsf(rule.threshold) > 100.0f) {
+                    return false;
+                }
+                break;
+            default:
+                // Any reading clears a missing-sensor alert, hysteresis doesn't apply
+                if (rule.threshold < 10.0f || rule.threshold > 86400.0f) {
+                    return false;
+                }
+                rule.hysteresis = 0.0f;
+                break;
+        }
+        count++;
+    }
+    return true;
+}
+
+void WebServerManager::sendStream(AsyncWebServerRequest* request, std::shared_ptr<HistoryStream> stream) {
+    // Records are rendered on demand straight into the TCP send buffer, so
+    // memory use stays constant regardless of how much history is requested
+    request->sendChunked("application/json", [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+        return stream->fill(buffer, maxLen);
+    });
+}
+
+size_t WebServerManager::HistoryStream::fill(uint8_t* buffer, size_t maxLen) {
+    size_t written = 0;
+    while (written < maxLen) {
+        // Drain whatever is left of the previously formatted piece first
+        if (pendingPos < pendingLen) {
+            size_t n = min(pendingLen - pendingPos, maxLen - written);
+            memcpy(buffer + written, pending + pendingPos, n);
+            pendingPos += n;
+            written += n;
+            continue;
+        }
+
+        pendingPos = 0;
+        pendingLen = 0;
+        if (state == HEADER) {
+            if (rollups) {
+                pendingLen = snprintf(pending, sizeof(pending),
+                                      "{\"tier\":\"%s\",\"bucketSeconds\":%lu,\"total\":%lu,\"rollups\":[",
+                                      RollupStore::getTierName(tier),
+                                      (unsigned long)RollupStore::getBucketSeconds(tier), (unsigned long)total);
+            } else if (quantiles) {
+                pendingLen = snprintf(pending, sizeof(pending), "{\"total\":%lu,\"days\":[", (unsigned long)total);
+            } else if (archive) {
+                // Readings come block by block, in time order per sensor
+                pendingLen = snprintf(pending, sizeof(pending), "{\"blocks\":%lu,\"readings\":[", (unsigned long)total);
+            } else {
+                pendingLen = snprintf(pending, sizeof(pending), "{\"total\":%lu,\"readings\":[", (unsigned long)total);
+            }
+            state = READINGS;
+        } else if (state == READINGS && rollups) {
+            RollupRecord bucket;
+            if (remaining > 0 && reader.next(&bucket)) {
+                remaining--;
+                pendingLen = snprintf(pending, sizeof(pending),
+                                      "%s{\"epoch\":%lu,\"min\":%.2f,\"max\":%.2f,\"avg\":%.2f,\"count\":%lu}",
+                                      first ? "" : ",", (unsigned long)bucket.epoch,
+                                      bucket.minCentiCelsius / 100.0f, bucket.maxCentiCelsius / 100.0f,
+                                      bucket.sumCentiCelsius / 100.0f / max((uint32_t)1, bucket.count),
+                                      (unsigned long)bucket.count);
+                first = false;
+            } else {
+                pendingLen = snprintf(pending, sizeof(pending), "]}");
+                state = DONE;
+            }
+        } else if (state == READINGS && quantiles) {
+            QuantileRecord day;
+            if (remaining > 0 && reader.next(&day)) {
+                remaining--;
+                pendingLen = snprintf(pending, sizeof(pending),
+                                      "%s{\"epoch\":%lu,\"count\":%lu,\"min\":%.2f,\"p50\":%.2f,\"p95\":%.2f,\"p99\":%.2f,\"max\":%.2f}",
+                                      first ? "" : ",", (unsigned long)day.epoch, (unsigned long)day.count,
+                                      QuantileSketch::getMin(day) / 100.0f,
+                                      QuantileSketch::get(day, QUANTILE_P50) / 100.0f,
+                                      QuantileSketch::get(day, QUANTILE_P95) / 100.0f,
+                                      QuantileSketch::get(day, QUANTILE_P99) / 100.0f,
+                                      QuantileSketch::getMax(day) / 100.0f);
+                first = false;
+            } else {
+                pendingLen = snprintf(pending, sizeof(pending), "]}");
+                state = DONE;
+            }
+        } else if (state == READINGS && archive) {
+            uint32_t epoch;
+            int16_t sixteenths;
+            TemperatureBlock block;
+            if (decoder.next(epoch, sixteenths)) {
+                if ((from > 0 && epoch < from) || (to > 0 && epoch > to)) {
+                    continue;
+                }
+                formatReading(epoch, decoder.getSensorId(), BlockEncoder::toCentiCelsius(sixteenths));
+            } else if (remaining > 0 && reader.next(&block)) {
+                remaining--;
+                if (sensorFilter < 0 || block.sensorId == sensorFilter) {
+                    decoder = BlockDecoder(block);
+                }
+            } else {
+                pendingLen = snprintf(pending, sizeof(pending), "]}");
+                state = DONE;
+            }
+        } else if (state == READINGS && step > 0) {
+            if (haveUpcoming && gridEpoch <= upcoming.epoch) {
+                bool bridged = havePrevious && upcoming.epoch - previous.epoch <= maxGap;
+                if (!bridged && gridEpoch < upcoming.epoch) {
+                    // Nothing to interpolate from, skip to the first grid point at the reading
+                    gridEpoch += (upcoming.epoch - gridEpoch + step - 1) / step * step;
+                    continue;
+                }
+
+                int32_t value = upcoming.centiCelsius;
+                if (gridEpoch < upcoming.epoch) {
+                    int64_t change = (int64_t)upcoming.centiCelsius - previous.centiCelsius;
+                    value = previous.centiCelsius +
+                            change * (gridEpoch - previous.epoch) / (upcoming.epoch - previous.epoch);
+                }
+                formatReading(gridEpoch, upcoming.sensorId, (int16_t)value);
+                gridEpoch += step;
+            } else if (haveUpcoming) {
+                previous = upcoming;
+                havePrevious = true;
+                haveUpcoming = false;
+            } else if (nextRecord(upcoming)) {
+                if (upcoming.sensorId != sensorFilter) {
+                    continue;
+                }
+                if (gridEpoch == 0) {
+                    gridEpoch = upcoming.epoch;
+                }
+                haveUpcoming = true;
+            } else {
+                pendingLen = snprintf(pending, sizeof(pending), "]}");
+                state = DONE;
+            }
+        } else if (state == READINGS) {
+            LogRecord record;
+            if (nextRecord(record)) {
+                if (sensorFilter >= 0 && record.sensorId != sensorFilter) {
+                    continue;
+                }
+                formatReading(record.epoch, record.sensorId, record.centiCelsius);
+            } else {
+                pendingLen = snprintf(pending, sizeof(pending), "]}");
+                state = DONE;
+            }
+        } else {
+            break;
+        }
+    }
+    return written;
+}
+
+bool WebServerManager::HistoryStream::nextRecord(LogRecord& record) {
+    if (remaining == 0 || !(cache ? cache->read(cursor, &record, 1) == 1 : reader.next(&record))) {
+        return false;
+    }
+    remaining--;
+    return true;
+}
+
+void WebServerManager::HistoryStream::formatReading(uint32_t epoch, uint8_t sensorId, int16_t centiCelsius) {
+    time_t timestamp = epoch;
+    struct tm timeinfo;
+    localtime_r(&timestamp, &timeinfo);
+    char timeStr[20];
+    strftime(timeStr, sizeof(timeStr), "%H:%M:%S", &timeinfo);
+
+    pendingLen = snprintf(pending, sizeof(pending),
+                          "%s{\"epoch\":%lu,\"timestamp\":\"%s\",\"sensor\":%u,\"temperature\":%.2f}",
+                          first ? "" : ",", (unsigned long)epoch, timeStr,
+                          (unsigned)sensorId, centiCelsius / 100.0f);
+    first = false;
+}
+
 void WebServerManager::setWiFiCredentialsCallback(std::function<void(const char*, const char*)> callback) {
     wifiCredentialsCallback = callback;
 }
@@ -184,48 +934,406 @@ void WebServerManager::setSystemResetCallback(std::function<void(void)> callback
     systemResetCallback = callback;
 }
 
-void WebServerManager::setSystemSettingsCallback(std::function<void(int, int, int)> callback) {
+void WebServerManager::setSystemSettingsCallback(std::function<void(const SystemSettings&)> callback) {
     systemSettingsCallback = callback;
 }
 
-void WebServerManager::broadcastTemperature(float temperature) {
-    if (ws->count() > 0) {
-        time_t now;
-        time(&now);
-        
-        // Format time string to match JSON log format
-        struct tm timeinfo;
-        localtime_r(&now, &timeinfo);
-        char timeStr[20];
-        strftime(timeStr, sizeof(timeStr), "%H:%M:%S", &timeinfo);
-        
-        // Send both the new reading and update trigger
-        String jsonString = "{\"update\":true,\"temperature\":";
-        jsonString += String(temperature, 4);  // More precision
-        jsonString += ",\"timestamp\":\"";
-        jsonString += timeStr;
-        jsonString += "\"}";
-        
-        ws->textAll(jsonString);
+void WebServerManager::setAlertRulesCallback(std::function<void(const AlertRule*, uint8_t)> callback) {
+    alertRulesCallback = callback;
+}
+
+void WebServerManager::broadcastTemperature(float temperature, uint8_t sensorId, time_t timestamp, uint8_t flags) {
+    // Readings are sequenced even with nobody connected, so the recent window
+    // is full for the next snapshot or resume
+    if (sensorId >= SensorManager::MAX_SENSORS) {
+        return;
+    }
+
+    if (timestamp == 0) {
+        time(&timestamp);
+    }
+
+    PendingReading& reading = pendingReadings[sensorId];
+    if (reading.pending && reading.flags != 0) {
+        // An anomalous reading must reach the clients, not be replaced
+        reading.pending = false;
+        sendReading(sensorId, reading);
+    } else if (reading.pending) {
+        coalescedFrames++;
+    }
+    reading.temperature = temperature;
+    reading.timestamp = timestamp;
+    reading.flags = flags;
+    reading.pending = true;
+}
+
+void WebServerManager::flushBroadcasts() {
+    for (uint8_t sensorId = 0; sensorId < SensorManager::MAX_SENSORS; sensorId++) {
+        PendingReading& reading = pendingReadings[sensorId];
+        if (reading.pending) {
+            reading.pending = false;
+            sendReading(sensorId, reading);
+        }
+    }
+}
+
+void WebServerManager::broadcastAlert(const AlertEvent& event) {
+    // Temperatures and rates go out in hundredths, missing times in whole seconds
+    float scale = event.type == ALERT_MISSING ? 1.0f : 100.0f;
+
+    char json[192];
+    int len = snprintf(json, sizeof(json),
+        "{\"alert\":true,\"rule\":%u,\"type\":\"%s\",\"sensor\":%u,\"active\":%s,\"value\":%.2f,\"threshold\":%.2f,\"epoch\":%lu}",
+        event.rule, AlertEngine::getTypeName(event.type), event.sensorId, event.active ? "true" : "false",
+        event.value, event.threshold, (unsigned long)event.epoch);
+
+    AsyncWebSocketSharedBuffer textFrame;
+    AsyncWebSocketSharedBuffer binaryFrame;
+    for (AsyncWebSocketClient& client : ws->getClients()) {
+        if (client.status() != WS_CONNECTED) {
+            continue;
+        }
+
+        bool binary = isBinaryClient(client.id());
+        AsyncWebSocketSharedBuffer& frame = binary ? binaryFrame : textFrame;
+        if (!frame && binary) {
+            BinaryAlert alert = {};
+            alert.type = FRAME_ALERT;
+            alert.sensorId = event.sensorId;
+            alert.rule = event.rule;
+            alert.alertType = event.type;
+            alert.epoch = event.epoch;
+            alert.active = event.active ? 1 : 0;
+            alert.value = (int32_t)lroundf(event.value * scale);
+            alert.threshold = (int32_t)lroundf(event.threshold * scale);
+            const uint8_t* bytes = (const uint8_t*)&alert;
+            frame = std::make_shared<std::vector<uint8_t>>(bytes, bytes + sizeof(alert));
+        } else if (!frame) {
+            frame = std::make_shared<std::vector<uint8_t>>(json, json + len);
+        }
+        sendFrame(&client, frame, binary);
+    }
+
+    if (events->count() > 0) {
+        events->send(json, "alert");
+    }
+}
+
+void WebServerManager::sendReading(uint8_t sensorId, const PendingReading& pending) {
+    RecentReading reading;
+    reading.sensorId = sensorId;
+    reading.centiCelsius = (int16_t)lroundf(pending.temperature * 100.0f);
+    reading.epoch = (uint32_t)pending.timestamp;
+    reading.flags = pending.flags;
+    {
+        std::lock_guard<std::mutex> lock(recentLock);
+        reading.seq = nextSeq++;
+        recentReadings[reading.seq % RECENT_WINDOW] = reading;
+    }
+
+    if (ws->count() == 0 && events->count() == 0) {
+        return;
+    }
+
+    // Each frame is built at most once and shared by all clients that use it
+    AsyncWebSocketSharedBuffer textFrame;
+    AsyncWebSocketSharedBuffer binaryFrame;
+
+    RunningStats sinceBoot;
+    RunningStats sinceReset;
+    bool haveStats = statsEngine && statsEngine->getStats(sensorId, sinceBoot, sinceReset);
+
+    for (AsyncWebSocketClient& client : ws->getClients()) {
+        if (client.status() != WS_CONNECTED) {
+            continue;
+        }
+
+        bool binary = isBinaryClient(client.id());
+        AsyncWebSocketSharedBuffer& frame = binary ? binaryFrame : textFrame;
+        if (!frame) {
+            frame = makeFrame(reading, binary, haveStats ? &sinceReset : nullptr);
+        }
+        sendFrame(&client, frame, binary);
+    }
+
+    if (events->count() > 0) {
+        char json[128];
+        formatReadingJson(reading, json, sizeof(json));
+        events->send(json, "reading", reading.seq);
+    }
+}
+
+void WebServerManager::replayEvents(AsyncEventSourceClient* client) {
+    // A fresh client has nothing to catch up on
+    uint32_t fromSeq = client->lastId() + 1;
+    if (client->lastId() == 0) {
+        return;
+    }
+
+    std::vector<RecentReading> missing;
+    uint32_t latest;
+    bool resync;
+    {
+        std::lock_guard<std::mutex> lock(recentLock);
+        uint32_t oldest = nextSeq > RECENT_WINDOW ? nextSeq - RECENT_WINDOW : 1;
+        latest = nextSeq - 1;
+        resync = fromSeq < oldest || fromSeq > nextSeq;
+        if (!resync) {
+            for (uint32_t seq = fromSeq; seq < nextSeq; seq++) {
+                missing.push_back(recentReadings[seq % RECENT_WINDOW]);
+            }
+        }
+    }
+
+    char json[128];
+    if (resync) {
+        snprintf(json, sizeof(json), "{\"seq\":%lu}", (unsigned long)latest);
+        client->send(json, "resync", latest);
+        return;
+    }
+
+    for (const RecentReading& reading : missing) {
+        formatReadingJson(reading, json, sizeof(json));
+        if (!client->send(json, "reading", reading.seq)) {
+            droppedFrames++;
+            break;
+        }
+    }
+}
+
+void WebServerManager::resendReadings(AsyncWebSocketClient* client, uint32_t fromSeq) {
+    std::vector<RecentReading> missing;
+    uint32_t latest;
+    bool resync;
+    {
+        std::lock_guard<std::mutex> lock(recentLock);
+        uint32_t oldest = nextSeq > RECENT_WINDOW ? nextSeq - RECENT_WINDOW : 1;
+        latest = nextSeq - 1;
+
+        // Too old for the window, or from before a reboot restarted the count
+        resync = fromSeq < oldest || fromSeq > nextSeq;
+        if (!resync) {
+            for (uint32_t seq = fromSeq; seq < nextSeq; seq++) {
+                missing.push_back(recentReadings[seq % RECENT_WINDOW]);
+            }
+        }
+    }
+
+    bool binary = isBinaryClient(client->id());
+    if (resync) {
+        sendFrame(client, makeResyncFrame(latest, binary), binary);
+        return;
+    }
+
+    for (const RecentReading& reading : missing) {
+        if (!sendFrame(client, makeFrame(reading, binary), binary)) {
+            break;
+        }
     }
 }
 
+void WebServerManager::sendSnapshot(AsyncWebSocketClient* client, bool binary) {
+    std::vector<RecentReading> readings;
+    uint32_t latest;
+    {
+        std::lock_guard<std::mutex> lock(recentLock);
+        uint32_t oldest = nextSeq > RECENT_WINDOW ? nextSeq - RECENT_WINDOW : 1;
+        latest = nextSeq - 1;
+        readings.reserve(nextSeq - oldest);
+        for (uint32_t seq = oldest; seq < nextSeq; seq++) {
+            readings.push_back(recentReadings[seq % RECENT_WINDOW]);
+        }
+    }
+    uint32_t totalSamples = dataLogger ? dataLogger->getEntryCount() : 0;
+
+    auto frame = std::make_shared<std::vector<uint8_t>>();
+    if (binary) {
+        BinarySnapshotHeader header;
+        header.type = FRAME_SNAPSHOT;
+        header.reserved = 0;
+        header.count = readings.size();
+        header.totalSamples = totalSamples;
+        header.seq = latest;
+
+        frame->resize(sizeof(header) + readings.size() * sizeof(BinarySnapshotReading));
+        uint8_t* out = frame->data();
+        memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+        for (const RecentReading& reading : readings) {
+            BinarySnapshotReading entry;
+            entry.epoch = reading.epoch;
+            entry.centiCelsius = reading.centiCelsius;
+            entry.sensorId = reading.sensorId;
+            entry.flags = reading.flags;
+            memcpy(out, &entry, sizeof(entry));
+            out += sizeof(entry);
+        }
+    } else {
+        char line[128];
+        frame->reserve(64 + readings.size() * 72);
+        auto append = [&](int len) {
+            frame->insert(frame->end(), line, line + len);
+        };
+
+        append(snprintf(line, sizeof(line), "{\"snapshot\":true,\"seq\":%lu,\"total\":%lu,\"readings\":[",
+                        (unsigned long)latest, (unsigned long)totalSamples));
+        for (size_t i = 0; i < readings.size(); i++) {
+            const RecentReading& reading = readings[i];
+            time_t timestamp = reading.epoch;
+            struct tm timeinfo;
+            localtime_r(&timestamp, &timeinfo);
+            char timeStr[20];
+            strftime(timeStr, sizeof(timeStr), "%H:%M:%S", &timeinfo);
+
+            append(snprintf(line, sizeof(line),
+                "%s{\"seq\":%lu,\"sensor\":%u,\"epoch\":%lu,\"temperature\":%.2f,\"timestamp\":\"%s\",\"flags\":%u}",
+                i > 0 ? "," : "", (unsigned long)reading.seq, reading.sensorId,
+                (unsigned long)reading.epoch, reading.centiCelsius / 100.0f, timeStr, reading.flags));
+        }
+        append(snprintf(line, sizeof(line), "]}"));
+    }
+
+    if (sendFrame(client, frame, binary)) {
+        snapshotsSent++;
+    }
+}
+
+AsyncWebSocketSharedBuffer WebServerManager::makeFrame(const RecentReading& reading, bool binary,
+                                                       const RunningStats* stats) {
+    if (binary) {
+        BinaryReading frame;
+        frame.type = FRAME_READING;
+        frame.sensorId = reading.sensorId;
+        frame.centiCelsius = reading.centiCelsius;
+        frame.epoch = reading.epoch;
+        frame.seq = reading.seq;
+        frame.flags = reading.flags;
+        memset(frame.reserved, 0, sizeof(frame.reserved));
+        const uint8_t* bytes = (const uint8_t*)&frame;
+        auto buffer = std::make_shared<std::vector<uint8_t>>(bytes, bytes + sizeof(frame));
+
+        if (stats) {
+            BinaryStats tail;
+            tail.count = stats->getCount();
+            tail.minCentiCelsius = (int16_t)lroundf(stats->getMin() * 100.0f);
+            tail.maxCentiCelsius = (int16_t)lroundf(stats->getMax() * 100.0f);
+            tail.meanCentiCelsius = (int16_t)lroundf(stats->getMean() * 100.0f);
+            tail.stdDevCentiCelsius = (uint16_t)lroundf(stats->getStdDev() * 100.0f);
+            tail.minEpoch = stats->getMinEpoch();
+            tail.maxEpoch = stats->getMaxEpoch();
+            const uint8_t* tailBytes = (const uint8_t*)&tail;
+            buffer->insert(buffer->end(), tailBytes, tailBytes + sizeof(tail));
+        }
+        return buffer;
+    }
+
+    char json[256];
+    int len = formatReadingJson(reading, json, sizeof(json));
+    if (stats && len > 0) {
+        // Reopen the reading object to add the statistics to it
+        len--;
+        len += snprintf(json + len, sizeof(json) - len,
+            ",\"stats\":{\"count\":%lu,\"min\":%.2f,\"max\":%.2f,\"mean\":%.2f,\"stddev\":%.2f}}",
+            (unsigned long)stats->getCount(), stats->getMin(), stats->getMax(),
+            stats->getMean(), stats->getStdDev());
+    }
+    return std::make_shared<std::vector<uint8_t>>(json, json + len);
+}
+
+int WebServerManager::formatReadingJson(const RecentReading& reading, char* json, size_t size) {
+    // Format time string to match JSON log format
+    time_t timestamp = reading.epoch;
+    struct tm timeinfo;
+    localtime_r(&timestamp, &timeinfo);
+    char timeStr[20];
+    strftime(timeStr, sizeof(timeStr), "%H:%M:%S", &timeinfo);
+
+    return snprintf(json, size,
+        "{\"seq\":%lu,\"sensor\":%u,\"epoch\":%lu,\"temperature\":%.2f,\"timestamp\":\"%s\",\"flags\":%u}",
+        (unsigned long)reading.seq, reading.sensorId, (unsigned long)reading.epoch,
+        reading.centiCelsius / 100.0f, timeStr, reading.flags);
+}
+
+AsyncWebSocketSharedBuffer WebServerManager::makeResyncFrame(uint32_t seq, bool binary) {
+    if (binary) {
+        BinaryReading frame = {};
+        frame.type = FRAME_RESYNC;
+        frame.seq = seq;
+        const uint8_t* bytes = (const uint8_t*)&frame;
+        return std::make_shared<std::vector<uint8_t>>(bytes, bytes + sizeof(frame));
+    }
+
+    char json[48];
+    int len = snprintf(json, sizeof(json), "{\"resync\":true,\"seq\":%lu}", (unsigned long)seq);
+    return std::make_shared<std::vector<uint8_t>>(json, json + len);
+}
+
+bool WebServerManager::sendFrame(AsyncWebSocketClient* client, AsyncWebSocketSharedBuffer frame, bool binary) {
+    // A slow client loses this frame rather than growing its queue
+    if (client->queueIsFull()) {
+        droppedFrames++;
+        return false;
+    }
+
+    bool queued = binary ? client->binary(frame) : client->text(frame);
+    if (!queued) {
+        droppedFrames++;
+    }
+    return queued;
+}
+
+bool WebServerManager::isBinaryClient(uint32_t id) {
+    std::lock_guard<std::mutex> lock(binaryClientsLock);
+    return std::find(binaryClients.begin(), binaryClients.end(), id) != binaryClients.end();
+}
+
 void WebServerManager::handleWebSocketMessage(AsyncWebSocket* server, AsyncWebSocketClient* client,
                                             AwsFrameInfo* info, uint8_t* data, size_t len) {
     if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
-        data[len] = 0;
+        JsonDocument doc;
+        if (deserializeJson(doc, data, len)) {
+            return;
+        }
+
+        // Gap request from a client that missed part of the sequence
+        if (doc["resend"].is<uint32_t>()) {
+            resendReadings(client, doc["resend"].as<uint32_t>());
+        }
+
+        // Time from page load until the first chart was drawn
+        if (doc["firstChartMs"].is<uint32_t>()) {
+            uint32_t ms = doc["firstChartMs"];
+            firstChartReports++;
+            firstChartTotalMs += ms;
+            firstChartMaxMs = max(firstChartMaxMs, ms);
+        }
     }
 }
 
 void WebServerManager::onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient* client,
                                       AwsEventType type, void* arg, uint8_t* data, size_t len) {
     switch (type) {
-        case WS_EVT_CONNECT:
-            // Client connected
+        case WS_EVT_CONNECT: {
+            // Clients opt into binary frames by subprotocol or query parameter
+            AsyncWebServerRequest* request = (AsyncWebServerRequest*)arg;
+            const AsyncWebHeader* protocol = request->getHeader("Sec-WebSocket-Protocol");
+            bool binary = (protocol && protocol->value().indexOf(WS_BINARY_PROTOCOL) >= 0) ||
+                          (request->hasParam("format") && request->getParam("format")->value() == "binary");
+            if (binary) {
+                std::lock_guard<std::mutex> lock(binaryClientsLock);
+                binaryClients.push_back(client->id());
+            }
+
+            // Lets the dashboard render without fetching history first
+            sendSnapshot(client, binary);
             break;
-        case WS_EVT_DISCONNECT:
-            // Client disconnected
+        }
+        case WS_EVT_DISCONNECT: {
+            std::lock_guard<std::mutex> lock(binaryClientsLock);
+            binaryClients.erase(std::remove(binaryClients.begin(), binaryClients.end(), client->id()),
+                                binaryClients.end());
             break;
+        }
         case WS_EVT_DATA:
             handleWebSocketMessage(server, client, (AwsFrameInfo*)arg, data, len);
             break;
@@ -235,6 +1343,40 @@ void WebServerManager::onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketCl
     }
 }
 
+void WebServerManager::setDataLogger(DataLogger* logger) {
+    dataLogger = logger;
+}
+
+void WebServerManager::setSensorManager(SensorManager* manager) {
+    sensorManager = manager;
+}
+
+void WebServerManager::setStatsEngine(StatsEngine* stats) {
+    statsEngine = stats;
+}
+
+void WebServerManager::setAlertEngine(AlertEngine* alerts) {
+    alertEngine = alerts;
+}
+
+void WebServerManager::setAnomalyDetector(AnomalyDetector* detector) {
+    anomalyDetector = detector;
+}
+
+void WebServerManager::writeStats(JsonObject out, const RunningStats& stats) {
+    out["count"] = stats.getCount();
+    if (stats.getCount() == 0) {
+        return;
+    }
+    out["mean"] = stats.getMean();
+    out["variance"] = stats.getVariance();
+    out["stddev"] = stats.getStdDev();
+    out["min"] = stats.getMin();
+    out["minEpoch"] = stats.getMinEpoch();
+    out["max"] = stats.getMax();
+    out["maxEpoch"] = stats.getMaxEpoch();
+}
+
 void WebServerManager::setAPMode(bool isAP) {
     isInAPMode = isAP;
 }
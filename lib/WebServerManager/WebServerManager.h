@@ -4,7 +4,38 @@
 #include <ESPAsyncWebServer.h>
 #include <SPIFFS.h>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include <ArduinoJson.h>
+#include "DataLogger.h"
+#include "SensorManager.h"
+#include "StatsEngine.h"
+#include "AlertEngine.h"
+#include "AnomalyDetector.h"
+
+/**
+ * @brief User adjustable settings, stored in /settings.json
+ */
+struct SystemSettings {
+    int loggingInterval = 300;          // Seconds between logged readings
+    int tempUpdateInterval = 5;         // Seconds between live updates
+    int maxLogEntries = 1000;
+    bool adaptiveResolution = false;    // "resolutionMode": "fixed" or "adaptive"
+    int sensorResolution = 12;          // Fixed resolution, or maximum when adaptive (9-12 bits)
+    int commitRecords = 16;             // Logged readings written to flash per batch (1-64)
+    int commitSeconds = 300;            // Longest a logged reading waits in RAM (1-3600)
+    bool compression = false;           // "compressionMode": "off" or "swinging-door"
+    float compressionTolerance = 0.1f;  // Largest error of an interpolated reading in °C (0.01-5)
+    int heartbeatSeconds = 3600;        // Longest time between compressed readings (60-86400)
+    uint32_t statsWindows[WindowStats::MAX_WINDOWS] = {900, 3600};  // Sliding windows in seconds (60-86400)
+    uint8_t statsWindowCount = 2;
+    float histogramMin = -10.0f;        // Lower edge of the first histogram bin in °C (-55-125)
+    float histogramMax = 40.0f;         // Upper edge of the last histogram bin in °C (-55-125)
+    float histogramBinWidth = 0.5f;     // Histogram bin width in °C (0.05-10), at most 512 bins
+    int anomalySpan = 720;              // Readings the anomaly baseline averages over (10-10000)
+    float anomalyThreshold = 4.0f;      // Standard deviations that flag a reading (2-10)
+};
 
 /**
  * @brief Manages the web server and WebSocket functionality
@@ -48,14 +79,95 @@ public:
      * 
      * @param callback Function to handle system settings update
      */
-    void setSystemSettingsCallback(std::function<void(int, int, int)> callback);
+    void setSystemSettingsCallback(std::function<void(const SystemSettings&)> callback);
+
+    /**
+     * @brief Set the callback function for alert rule updates
+     * 
+     * @param callback Function to handle the validated rules posted to /api/alerts
+     */
+    void setAlertRulesCallback(std::function<void(const AlertRule*, uint8_t)> callback);
 
     /**
-     * @brief Broadcast temperature data to all connected WebSocket clients
+     * @brief Queue temperature data for all connected WebSocket and SSE clients
+     * 
+     * Readings are sent by flushBroadcasts(). If a sensor already has a reading
+     * waiting, the newer one replaces it and the older frame is counted as
+     * coalesced, unless the older one is flagged, which is sent first instead.
      * 
      * @param temperature Current temperature reading
+     * @param sensorId Index of the sensor that produced the reading
+     * @param timestamp Time the reading was taken, 0 for the current time
+     * @param flags AnomalyFlag bits of the reading
+     */
+    void broadcastTemperature(float temperature, uint8_t sensorId = 0, time_t timestamp = 0, uint8_t flags = 0);
+
+    /**
+     * @brief Send all queued readings to the connected WebSocket clients
+     * 
+     * Clients that connected with the WS_BINARY_PROTOCOL subprotocol or with
+     * ?format=binary get a BinaryReading frame, all others get JSON text. Each
+     * frame is serialized once and shared by every client queue; clients whose
+     * queue is full are skipped and the frame is counted as dropped. With a
+     * StatsEngine set, the sensor's statistics since reset ride along.
+     */
+    void flushBroadcasts();
+
+    /**
+     * @brief Send an alert being raised or cleared to all WebSocket and SSE clients
+     * 
+     * Alerts go out right away rather than with the next flushBroadcasts().
+     * They aren't sequenced, a client that connects later reads the current
+     * alerts from /api/alerts.
+     * 
+     * @param event Alert raised or cleared
+     */
+    void broadcastAlert(const AlertEvent& event);
+
+    /**
+     * @brief Number of frames not queued for a client because its queue was full
+     */
+    uint32_t getDroppedFrames() const { return droppedFrames; }
+
+    /**
+     * @brief Number of readings replaced by a newer one before they were sent
+     */
+    uint32_t getCoalescedFrames() const { return coalescedFrames; }
+
+    /**
+     * @brief Set the data logger used to serve temperature history
+     * 
+     * @param logger Data logger instance, or nullptr if logging is unavailable
+     */
+    void setDataLogger(DataLogger* logger);
+
+    /**
+     * @brief Set the sensor manager used to describe the sensors on the bus
+     * 
+     * @param manager Sensor manager instance
+     */
+    void setSensorManager(SensorManager* manager);
+
+    /**
+     * @brief Set the statistics served on /api/stats and sent with live readings
+     * 
+     * @param stats Statistics instance, or nullptr to leave them out
+     */
+    void setStatsEngine(StatsEngine* stats);
+
+    /**
+     * @brief Set the alert rules served on /api/alerts
+     * 
+     * @param alerts Alert engine instance, or nullptr if alerts are unavailable
+     */
+    void setAlertEngine(AlertEngine* alerts);
+
+    /**
+     * @brief Set the anomaly detector whose baselines are served on /api/stats
+     * 
+     * @param detector Detector instance, or nullptr to leave them out
      */
-    void broadcastTemperature(float temperature);
+    void setAnomalyDetector(AnomalyDetector* detector);
 
     /**
      * @brief Set whether the device is in AP mode
@@ -65,15 +177,216 @@ public:
     void setAPMode(bool isAP);
 
 private:
+    // WebSocket subprotocol a client offers to receive binary frames
+    static constexpr const char* WS_BINARY_PROTOCOL = "temperature.bin";
+
+    // Live readings carry a sequence number that grows by one per reading sent.
+    // A client that sees a jump sends {"resend":<first missing seq>} and gets
+    // the missing readings from the recent window, or a resync frame if they
+    // are no longer held and it has to reload history over HTTP. The same
+    // numbers are the SSE event ids on /api/events, so Last-Event-ID resumes.
+    static const uint32_t RECENT_WINDOW = 128;
+
+    enum BinaryFrameType : uint8_t {
+        FRAME_READING = 1,
+        FRAME_RESYNC = 2,
+        FRAME_SNAPSHOT = 3,
+        FRAME_ALERT = 4
+    };
+
+    /**
+     * @brief Live reading as sent to binary clients, little endian
+     */
+    struct __attribute__((packed)) BinaryReading {
+        uint8_t type;           // FRAME_READING, or FRAME_RESYNC with only seq set
+        uint8_t sensorId;
+        int16_t centiCelsius;   // Temperature in 1/100 °C
+        uint32_t epoch;         // Unix time of the reading
+        uint32_t seq;           // Sequence number, latest one sent for FRAME_RESYNC
+        uint8_t flags;          // AnomalyFlag bits
+        uint8_t reserved[3];
+    };
+
+    /**
+     * @brief Statistics since reset appended to a live BinaryReading
+     *
+     * Only frames sent as the reading happens carry it; resent readings are
+     * a bare BinaryReading.
+     */
+    struct __attribute__((packed)) BinaryStats {
+        uint32_t count;
+        int16_t minCentiCelsius;
+        int16_t maxCentiCelsius;
+        int16_t meanCentiCelsius;
+        uint16_t stdDevCentiCelsius;
+        uint32_t minEpoch;
+        uint32_t maxEpoch;
+    };
+
+    /**
+     * @brief Start of the snapshot sent to a binary client when it connects
+     *
+     * Followed by `count` BinarySnapshotReading entries, oldest first, with
+     * consecutive sequence numbers ending at `seq`.
+     */
+    struct __attribute__((packed)) BinarySnapshotHeader {
+        uint8_t type;           // FRAME_SNAPSHOT
+        uint8_t reserved;
+        uint16_t count;
+        uint32_t totalSamples;  // Readings in the log
+        uint32_t seq;           // Sequence number of the newest reading, 0 if none
+    };
+
+    struct __attribute__((packed)) BinarySnapshotReading {
+        uint32_t epoch;
+        int16_t centiCelsius;
+        uint8_t sensorId;
+        uint8_t flags;          // AnomalyFlag bits
+    };
+
+    /**
+     * @brief Alert raised or cleared, as sent to binary clients
+     */
+    struct __attribute__((packed)) BinaryAlert {
+        uint8_t type;           // FRAME_ALERT
+        uint8_t sensorId;
+        uint8_t rule;           // Index of the rule in /api/alerts
+        uint8_t alertType;      // AlertType
+        uint32_t epoch;
+        uint8_t active;         // 1 when raised, 0 when cleared
+        uint8_t reserved[3];
+        int32_t value;          // 1/100 of °C, °C/min or seconds, as for the rule type
+        int32_t threshold;      // Same unit as value
+    };
+
+    /**
+     * @brief A sent reading kept for gap requests and connect snapshots
+     */
+    struct RecentReading {
+        uint32_t seq;
+        uint32_t epoch;
+        int16_t centiCelsius;
+        uint8_t sensorId;
+        uint8_t flags;
+    };
+
+    /**
+     * @brief Incremental JSON renderer for a range of logged readings, rollups, archive blocks
+     *        or daily quantiles
+     */
+    struct HistoryStream {
+        enum State { HEADER, READINGS, DONE };
+
+        RingLog::Reader reader;
+        std::shared_ptr<SampleCache> cache;  // Set when readings come from RAM instead of reader
+        SampleCache::Cursor cursor;
+        uint32_t remaining = 0;
+        uint32_t total = 0;
+        bool rollups = false;   // Reader returns RollupRecords instead of LogRecords
+        bool archive = false;   // Reader returns TemperatureBlocks instead of LogRecords
+        bool quantiles = false; // Reader returns QuantileRecords instead of LogRecords
+        BlockDecoder decoder;   // Block being emitted when reading the archive
+        uint32_t from = 0;      // Archive readings outside [from, to] are skipped, 0 for open ends
+        uint32_t to = 0;
+        int sensorFilter = -1;  // Only emit readings of this sensor, -1 for all
+        uint32_t step = 0;      // Interpolate readings every step seconds, 0 to emit them as logged
+        uint32_t maxGap = 0;    // Longest gap between logged readings that is interpolated across
+        uint32_t gridEpoch = 0; // Next interpolated timestamp, 0 until the first reading
+        LogRecord previous;     // Logged readings around gridEpoch
+        LogRecord upcoming;
+        bool havePrevious = false;
+        bool haveUpcoming = false;
+        RollupTier tier = ROLLUP_MINUTE;
+        State state = HEADER;
+        bool first = true;
+        char pending[128];
+        size_t pendingLen = 0;
+        size_t pendingPos = 0;
+
+        /**
+         * @brief Write the next part of the response into buffer
+         * 
+         * @return size_t Bytes written, 0 once the response is complete
+         */
+        size_t fill(uint8_t* buffer, size_t maxLen);
+
+        /**
+         * @brief Format one reading into pending
+         */
+        void formatReading(uint32_t epoch, uint8_t sensorId, int16_t centiCelsius);
+
+        /**
+         * @brief Read the next logged reading from the cache or the reader
+         */
+        bool nextRecord(LogRecord& record);
+    };
+
     AsyncWebServer* server;
     AsyncWebSocket* ws;
+    AsyncEventSource* events;
     uint16_t port;
     bool isInAPMode;
+    DataLogger* dataLogger;
+    SensorManager* sensorManager;
+    StatsEngine* statsEngine;
+    AlertEngine* alertEngine;
+    AnomalyDetector* anomalyDetector;
     std::function<void(const char*, const char*)> wifiCredentialsCallback;
     std::function<void(void)> systemResetCallback;
-    std::function<void(int, int, int)> systemSettingsCallback;
+    std::function<void(const SystemSettings&)> systemSettingsCallback;
+    std::function<void(const AlertRule*, uint8_t)> alertRulesCallback;
+
+    // Newest unsent reading of each sensor
+    struct PendingReading {
+        float temperature;
+        time_t timestamp;
+        uint8_t flags;
+        bool pending;
+    };
+
+    PendingReading pendingReadings[SensorManager::MAX_SENSORS];
+    uint32_t droppedFrames;
+    uint32_t coalescedFrames;
+
+    // Last RECENT_WINDOW readings sent, slot seq % RECENT_WINDOW. Written by
+    // loop(), read when answering gap requests on the network task
+    RecentReading recentReadings[RECENT_WINDOW];
+    uint32_t nextSeq;
+    std::mutex recentLock;
+
+    // Time-to-first-chart as reported by dashboards, in milliseconds
+    uint32_t snapshotsSent;
+    uint32_t firstChartReports;
+    uint32_t firstChartTotalMs;
+    uint32_t firstChartMaxMs;
+
+    // Ids of WebSocket clients that negotiated binary frames. Written from the
+    // network task on connect/disconnect, read by broadcasts from loop()
+    std::vector<uint32_t> binaryClients;
+    std::mutex binaryClientsLock;
+
+    bool isBinaryClient(uint32_t id);
+    void sendReading(uint8_t sensorId, const PendingReading& reading);
+    void resendReadings(AsyncWebSocketClient* client, uint32_t fromSeq);
+    void sendSnapshot(AsyncWebSocketClient* client, bool binary);
+    void replayEvents(AsyncEventSourceClient* client);
+    AsyncWebSocketSharedBuffer makeFrame(const RecentReading& reading, bool binary,
+                                         const RunningStats* stats = nullptr);
+    static int formatReadingJson(const RecentReading& reading, char* json, size_t size);
+    static void writeStats(JsonObject out, const RunningStats& stats);
+    AsyncWebSocketSharedBuffer makeResyncFrame(uint32_t seq, bool binary);
+    bool sendFrame(AsyncWebSocketClient* client, AsyncWebSocketSharedBuffer frame, bool binary);
 
     void setupRoutes();
+    void sendHistory(AsyncWebServerRequest* request);
+    void sendRollups(AsyncWebServerRequest* request);
+    void sendArchive(AsyncWebServerRequest* request);
+    void sendQuantiles(AsyncWebServerRequest* request);
+    void sendWindowStats(AsyncWebServerRequest* request, uint32_t window);
+    void sendHistogram(AsyncWebServerRequest* request);
+    void sendAlerts(AsyncWebServerRequest* request);
+    static bool parseAlertRules(JsonArrayConst list, AlertRule* rules, uint8_t& count);
+    void sendStream(AsyncWebServerRequest* request, std::shared_ptr<HistoryStream> stream);
     void handleWebSocketMessage(AsyncWebSocket* server, AsyncWebSocketClient* client, 
                               AwsFrameInfo* info, uint8_t* data, size_t len);
     void onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient* client,
@@ -4,6 +4,10 @@
 #include "WebServerManager.h"
 #include "ResetManager.h"
 #include "DataLogger.h"
+#include "AcquisitionTask.h"
+#include "StatsEngine.h"
+#include "AlertEngine.h"
+#include "AnomalyDetector.h"
 #include <time.h>
 #include <SPIFFS.h>
 #include <ArduinoJson.h>
@@ -19,41 +23,62 @@ const int daylightOffset_sec = 3600;  // 1 hour DST
 #define RED_LED            5     // Red LED pin
 #define BLUE_LED           18    // Blue LED pin
 
+// The data logger keeps its log and rollup files open, leave room for the web server
+#define SPIFFS_MAX_OPEN_FILES 16
+
+// How many of the newest readings are also kept in RAM
+#define HOT_CACHE_ENTRIES 1024
+
 // Global objects
 SensorManager* sensorManager;
 WifiManager* wifiManager;
 WebServerManager* webServerManager;
 ResetManager* resetManager;
 DataLogger* dataLogger;
+AcquisitionTask* acquisitionTask;
+StatsEngine* statsEngine;
+AlertEngine* alertEngine;
+AnomalyDetector* anomalyDetector;
 
-// Timer for temperature updates
-unsigned long lastTempUpdate = 0;
+// Temperature update interval, sampling itself runs in the acquisition task
 unsigned long TEMP_UPDATE_INTERVAL = 5000; // 5 seconds
 
+// Sampling round the current logging decision was made for
+uint32_t lastLoggedTick = 0;
+bool logDue = false;
+
+// Set by the web server task, the logger settings are applied from loop()
+volatile bool loggerSettingsPending = false;
+
 // SPIFFS status
 bool spiffsInitialized = false;
 
 // System settings
-struct SystemSettings {
-    int loggingInterval;
-    int tempUpdateInterval;
-    int maxLogEntries;
-} settings;
+SystemSettings settings;
 
 // Function declarations
 bool initializeSPIFFS();
 void loadSettings();
 void saveSettings();
-void handleSystemSettings(int loggingInterval, int tempUpdateInterval, int maxLogEntries);
+void handleSystemSettings(const SystemSettings& newSettings);
+void loadAlertRules();
+void saveAlertRules(const AlertRule* rules, uint8_t count);
+void handleAlertRules(const AlertRule* rules, uint8_t count);
+void handleAlert(const AlertEvent& event);
+void updateRedLed();
+void applyLoggerSettings();
+Histogram::Layout histogramLayout();
+void logSamples();
+void broadcastSamples();
 
 bool initializeSPIFFS() {
-    if (!SPIFFS.begin(true)) {
+    if (!SPIFFS.begin(true, "/spiffs", SPIFFS_MAX_OPEN_FILES)) {
         Serial.println("Failed to mount SPIFFS. Trying to format...");
         if (!SPIFFS.format()) {
             Serial.println("Failed to format SPIFFS");
             return false;
         }
-        if (!SPIFFS.begin(true)) {
+        if (!SPIFFS.begin(true, "/spiffs", SPIFFS_MAX_OPEN_FILES)) {
             Serial.println("Failed to mount SPIFFS after formatting");
             return false;
         }
@@ -67,18 +92,14 @@ void loadSettings() {
     if (!spiffsInitialized) {
         Serial.println("Cannot load settings - SPIFFS not initialized");
         // Use default settings
-        settings.loggingInterval = 300;    // 5 minutes
-        settings.tempUpdateInterval = 5;    // 5 seconds
-        settings.maxLogEntries = 1000;     // 1000 entries
+        settings = SystemSettings();
         return;
     }
 
     File file = SPIFFS.open("/settings.json", "r");
     if (!file) {
         // Default settings
-        settings.loggingInterval = 300;    // 5 minutes
-        settings.tempUpdateInterval = 5;    // 5 seconds
-        settings.maxLogEntries = 1000;     // 1000 entries
+        settings = SystemSettings();
         saveSettings();
         return;
     }
@@ -95,6 +116,26 @@ void loadSettings() {
     settings.loggingInterval = doc["loggingInterval"] | 300;
     settings.tempUpdateInterval = doc["tempUpdateInterval"] | 5;
     settings.maxLogEntries = doc["maxLogEntries"] | 1000;
+    settings.adaptiveResolution = strcmp(doc["resolutionMode"] | "fixed", "adaptive") == 0;
+    settings.sensorResolution = constrain(doc["sensorResolution"] | 12, 9, 12);
+    settings.commitRecords = constrain(doc["commitRecords"] | 16, 1, 64);
+    settings.commitSeconds = constrain(doc["commitSeconds"] | 300, 1, 3600);
+    settings.compression = strcmp(doc["compressionMode"] | "off", "swinging-door") == 0;
+    settings.compressionTolerance = constrain(doc["compressionTolerance"] | 0.1f, 0.01f, 5.0f);
+    settings.heartbeatSeconds = constrain(doc["heartbeatSeconds"] | 3600, 60, 86400);
+    if (doc["statsWindows"].is<JsonArray>()) {
+        settings.statsWindowCount = 0;
+        for (JsonVariant window : doc["statsWindows"].as<JsonArray>()) {
+            if (settings.statsWindowCount < WindowStats::MAX_WINDOWS) {
+                settings.statsWindows[settings.statsWindowCount++] = constrain(window | 900, 60, 86400);
+            }
+        }
+    }
+    settings.histogramMin = constrain(doc["histogramMin"] | -10.0f, -55.0f, 125.0f);
+    settings.histogramMax = constrain(doc["histogramMax"] | 40.0f, -55.0f, 125.0f);
+    settings.histogramBinWidth = constrain(doc["histogramBinWidth"] | 0.5f, 0.05f, 10.0f);
+    settings.anomalySpan = constrain(doc["anomalySpan"] | 720, 10, 10000);
+    settings.anomalyThreshold = constrain(doc["anomalyThreshold"] | 4.0f, 2.0f, 10.0f);
 
     // Update intervals
     TEMP_UPDATE_INTERVAL = settings.tempUpdateInterval * 1000;
@@ -110,6 +151,22 @@ void saveSettings() {
     doc["loggingInterval"] = settings.loggingInterval;
     doc["tempUpdateInterval"] = settings.tempUpdateInterval;
     doc["maxLogEntries"] = settings.maxLogEntries;
+    doc["resolutionMode"] = settings.adaptiveResolution ? "adaptive" : "fixed";
+    doc["sensorResolution"] = settings.sensorResolution;
+    doc["commitRecords"] = settings.commitRecords;
+    doc["commitSeconds"] = settings.commitSeconds;
+    doc["compressionMode"] = settings.compression ? "swinging-door" : "off";
+    doc["compressionTolerance"] = settings.compressionTolerance;
+    doc["heartbeatSeconds"] = settings.heartbeatSeconds;
+    JsonArray windows = doc["statsWindows"].to<JsonArray>();
+    for (uint8_t i = 0; i < settings.statsWindowCount; i++) {
+        windows.add(settings.statsWindows[i]);
+    }
+    doc["histogramMin"] = settings.histogramMin;
+    doc["histogramMax"] = settings.histogramMax;
+    doc["histogramBinWidth"] = settings.histogramBinWidth;
+    doc["anomalySpan"] = settings.anomalySpan;
+    doc["anomalyThreshold"] = settings.anomalyThreshold;
 
     File file = SPIFFS.open("/settings.json", "w");
     if (!file) {
@@ -123,22 +180,117 @@ void saveSettings() {
     file.close();
 }
 
-void handleSystemSettings(int loggingInterval, int tempUpdateInterval, int maxLogEntries) {
-    settings.loggingInterval = loggingInterval;
-    settings.tempUpdateInterval = tempUpdateInterval;
-    settings.maxLogEntries = maxLogEntries;
+void handleSystemSettings(const SystemSettings& newSettings) {
+    // Reconfiguring the detector restarts its baselines, so only when it changed
+    bool anomalyChanged = newSettings.anomalySpan != settings.anomalySpan ||
+                          newSettings.anomalyThreshold != settings.anomalyThreshold;
+    settings = newSettings;
     
     saveSettings();
     
     // Update intervals
     TEMP_UPDATE_INTERVAL = settings.tempUpdateInterval * 1000;
-    if (dataLogger) {
-        delete dataLogger;
-        dataLogger = new DataLogger("/temperature_log.json", settings.loggingInterval);
-        if (spiffsInitialized) {
-            dataLogger->begin();
+    if (acquisitionTask) {
+        acquisitionTask->configure(TEMP_UPDATE_INTERVAL, settings.adaptiveResolution, settings.sensorResolution);
+    }
+    statsEngine->setWindows(settings.statsWindows, settings.statsWindowCount);
+    statsEngine->setHistogram(histogramLayout());
+    if (anomalyChanged) {
+        anomalyDetector->configure(settings.anomalySpan, settings.anomalyThreshold);
+    }
+    loggerSettingsPending = true;
+}
+
+void loadAlertRules() {
+    if (!spiffsInitialized || !SPIFFS.exists("/alerts.json")) {
+        return;
+    }
+
+    File file = SPIFFS.open("/alerts.json", "r");
+    if (!file) {
+        Serial.println("Failed to open alerts file");
+        return;
+    }
+
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+
+    if (error) {
+        Serial.println("Failed to read alerts file");
+        return;
+    }
+
+    AlertRule rules[AlertEngine::MAX_RULES];
+    uint8_t count = 0;
+    for (JsonVariant entry : doc["rules"].as<JsonArray>()) {
+        // A hand-edited or older file may hold more rules than fit
+        if (count >= AlertEngine::MAX_RULES) {
+            Serial.println("Too many alert rules, ignoring the rest");
+            break;
+        }
+        AlertRule& rule = rules[count];
+        if (!AlertEngine::parseType(entry["type"] | "", rule.type)) {
+            continue;
+        }
+        rule.sensorId = constrain(entry["sensor"] | 0, 0, SensorManager::MAX_SENSORS - 1);
+        rule.threshold = entry["threshold"] | 0.0f;
+        rule.hysteresis = constrain(entry["hysteresis"] | 0.0f, 0.0f, 10.0f);
+        rule.holdSeconds = constrain(entry["holdSeconds"] | 0L, 0L, 86400L);
+        if (rule.type == ALERT_MISSING) {
+            rule.threshold = constrain(rule.threshold, 10.0f, 86400.0f);
+            rule.hysteresis = 0.0f;
         }
+        count++;
+    }
+    alertEngine->setRules(rules, count);
+}
+
+void saveAlertRules(const AlertRule* rules, uint8_t count) {
+    if (!spiffsInitialized) {
+        Serial.println("Cannot save alerts - SPIFFS not initialized");
+        return;
+    }
+
+    JsonDocument doc;
+    JsonArray list = doc["rules"].to<JsonArray>();
+    for (uint8_t i = 0; i < count; i++) {
+        JsonObject rule = list.add<JsonObject>();
+        rule["type"] = AlertEngine::getTypeName(rules[i].type);
+        rule["sensor"] = rules[i].sensorId;
+        rule["threshold"] = rules[i].threshold;
+        rule["hysteresis"] = rules[i].hysteresis;
+        rule["holdSeconds"] = rules[i].holdSeconds;
+    }
+
+    File file = SPIFFS.open("/alerts.json", "w");
+    if (!file) {
+        Serial.println("Failed to create alerts file");
+        return;
+    }
+
+    if (serializeJson(doc, file) == 0) {
+        Serial.println("Failed to write alerts file");
     }
+    file.close();
+}
+
+void handleAlertRules(const AlertRule* rules, uint8_t count) {
+    alertEngine->setRules(rules, count);
+    saveAlertRules(rules, count);
+    updateRedLed();
+}
+
+void handleAlert(const AlertEvent& event) {
+    Serial.printf("Alert %u (%s, sensor %u) %s: %.2f\n", event.rule, AlertEngine::getTypeName(event.type),
+                  event.sensorId, event.active ? "raised" : "cleared", event.value);
+    webServerManager->broadcastAlert(event);
+    updateRedLed();
+}
+
+void updateRedLed() {
+    // The red LED also reports a failed SPIFFS, which an alert clearing mustn't hide
+    digitalWrite(RED_LED, (alertEngine->getActiveCount() > 0 || !spiffsInitialized) ? HIGH : LOW);
 }
 
 void handleReset() {
@@ -195,18 +347,29 @@ void setup() {
     loadSettings();
 
     // Initialize managers
-    sensorManager = new SensorManager(TEMPERATURE_SENSOR);
+    sensorManager = new SensorManager(TEMPERATURE_SENSOR, TEMP_UPDATE_INTERVAL);
+    sensorManager->setResolutionPolicy(settings.adaptiveResolution, settings.sensorResolution);
     wifiManager = new WifiManager();
     webServerManager = new WebServerManager();
+    statsEngine = new StatsEngine();
+    statsEngine->setWindows(settings.statsWindows, settings.statsWindowCount);
+    statsEngine->setHistogram(histogramLayout());
+    alertEngine = new AlertEngine();
+    anomalyDetector = new AnomalyDetector(settings.anomalySpan, settings.anomalyThreshold);
+    alertEngine->setCallback(handleAlert);
+    loadAlertRules();
     
     // Set up callbacks immediately after creating webServerManager
     webServerManager->setSystemSettingsCallback(handleSystemSettings);
+    webServerManager->setAlertRulesCallback(handleAlertRules);
     
     // Then continue with initialization
     resetManager = new ResetManager(RESET_BUTTON);
     
     if (spiffsInitialized) {
-        dataLogger = new DataLogger("/temperature_log.json", settings.loggingInterval);
+        dataLogger = new DataLogger("/temperature_log.bin", settings.loggingInterval, settings.maxLogEntries, HOT_CACHE_ENTRIES);
+        dataLogger->setCommitPolicy(settings.commitRecords, settings.commitSeconds);
+        dataLogger->setCompression(settings.compression, settings.compressionTolerance, settings.heartbeatSeconds);
     }
 
     // Initialize components
@@ -214,6 +377,13 @@ void setup() {
         Serial.println("Failed to initialize temperature sensor!");
     }
 
+    // From here on the sensor bus is owned by the acquisition task
+    acquisitionTask = new AcquisitionTask(sensorManager, TEMP_UPDATE_INTERVAL);
+    acquisitionTask->setAnomalyDetector(anomalyDetector);
+    if (!acquisitionTask->begin()) {
+        Serial.println("Failed to start acquisition task!");
+    }
+
     if (!wifiManager->begin()) {
         Serial.println("Failed to initialize WiFi!");
     }
@@ -233,6 +403,11 @@ void setup() {
     // Set up callbacks
     webServerManager->setWiFiCredentialsCallback(handleWiFiCredentials);
     webServerManager->setSystemResetCallback(handleReset);
+    webServerManager->setDataLogger(dataLogger);
+    webServerManager->setSensorManager(sensorManager);
+    webServerManager->setStatsEngine(statsEngine);
+    webServerManager->setAlertEngine(alertEngine);
+    webServerManager->setAnomalyDetector(anomalyDetector);
     resetManager->setResetCallback(handleReset);
 
     // Set AP mode state based on WiFi connection
@@ -261,53 +436,100 @@ void setup() {
     }
 }
 
-void loop() {
-    resetManager->check();
+void applyLoggerSettings() {
+    if (!loggerSettingsPending) {
+        return;
+    }
+    loggerSettingsPending = false;
 
-    if (millis() - lastTempUpdate >= TEMP_UPDATE_INTERVAL) {
-        lastTempUpdate = millis();
-        
-        if (sensorManager->isSensorWorking()) {
-            float temperature = sensorManager->getTemperature();
-            
-            // Get current timestamp
-            time_t now;
-            time(&now);
-            struct tm timeinfo;
-            localtime_r(&now, &timeinfo);
-            char timeStr[20];
-            strftime(timeStr, sizeof(timeStr), "%H:%M:%S", &timeinfo);
-            
-            // Log temperature with timestamp
-            if (wifiManager->isConnected()) {
-                Serial.printf("WiFi Mode - Time: %s, Temperature: %.1f°C (logged)\n", timeStr, temperature);
-                
-                // Only try to log if SPIFFS is initialized and we're in WiFi mode
-                if (spiffsInitialized && dataLogger) {
-                    // Check if it's time to log the temperature
-                    if (dataLogger->shouldLog()) {
-                        time_t now = time(nullptr);
-                        // Only log if we have valid NTP time (timestamp > Jan 1, 2024)
-                        if (now > 1704067200) {  // Unix timestamp for Jan 1, 2024
-                            if (!dataLogger->logTemperature(temperature)) {
-                                // Try to reinitialize SPIFFS if logging fails
-                                if (initializeSPIFFS()) {
-                                    dataLogger->logTemperature(temperature);
-                                }
-                            }
-                        }
+    // The logger stays in place, so open history readers and the cache survive
+    if (dataLogger) {
+        dataLogger->setLoggingInterval(settings.loggingInterval);
+        dataLogger->setMaxEntries(settings.maxLogEntries);
+        dataLogger->setCommitPolicy(settings.commitRecords, settings.commitSeconds);
+        dataLogger->setCompression(settings.compression, settings.compressionTolerance, settings.heartbeatSeconds);
+    }
+}
+
+Histogram::Layout histogramLayout() {
+    // A hand-edited settings file may hold a range the web form would refuse
+    int16_t low = lroundf(settings.histogramMin * 100.0f);
+    uint16_t width = lroundf(settings.histogramBinWidth * 100.0f);
+    float span = max(settings.histogramMax - settings.histogramMin, settings.histogramBinWidth);
+    uint16_t bins = min((long)ceilf(span / settings.histogramBinWidth), (long)Histogram::MAX_BINS);
+    return Histogram::Layout{low, width, bins};
+}
+
+void logSamples() {
+    AcquisitionTask::SampleQueue& queue = acquisitionTask->getLogQueue();
+    Sample sample;
+    while (queue.pop(sample)) {
+        // All sensors of one sampling round are logged together
+        if (sample.tick != lastLoggedTick) {
+            lastLoggedTick = sample.tick;
+            logDue = spiffsInitialized && dataLogger && dataLogger->shouldLog();
+        }
+
+        // Get the time the sample was taken
+        time_t sampleTime = sample.epoch;
+        struct tm timeinfo;
+        localtime_r(&sampleTime, &timeinfo);
+        char timeStr[20];
+        strftime(timeStr, sizeof(timeStr), "%H:%M:%S", &timeinfo);
+
+        // Log temperature with timestamp
+        if (wifiManager->isConnected()) {
+            Serial.printf("WiFi Mode - Time: %s, Sensor %u: %.1f°C (logged)\n", timeStr, sample.sensorId, sample.temperature);
+
+            // Only try to log if SPIFFS is initialized and we're in WiFi mode
+            // Only log if we have valid NTP time (timestamp > Jan 1, 2024)
+            // Anomalous readings are logged even between logging intervals
+            bool flagged = sample.flags != 0 && spiffsInitialized && dataLogger;
+            bool timeValid = sampleTime > 1704067200;  // Unix timestamp for Jan 1, 2024
+            if (spiffsInitialized && dataLogger && timeValid) {
+                // Daily quantiles see every sample, not just the logged ones
+                dataLogger->addSample(sample.temperature, sample.sensorId, sampleTime);
+            }
+            if ((logDue || flagged) && timeValid) {
+                if (!dataLogger->logTemperature(sample.temperature, sample.sensorId, sampleTime, sample.flags)) {
+                    // Try to reinitialize SPIFFS if logging fails
+                    if (initializeSPIFFS()) {
+                        dataLogger->logTemperature(sample.temperature, sample.sensorId, sampleTime, sample.flags);
                     }
                 }
-            } else {
-                Serial.printf("AP Mode - Temperature: %.1f°C (no logs)\n", temperature);
             }
-            
-            // Broadcast to WebSocket clients without serial output
-            webServerManager->broadcastTemperature(temperature);
         } else {
-            Serial.println("Error reading temperature sensor!");
+            Serial.printf("AP Mode - Sensor %u: %.1f°C (no logs)\n", sample.sensorId, sample.temperature);
         }
     }
+}
+
+void broadcastSamples() {
+    AcquisitionTask::SampleQueue& queue = acquisitionTask->getBroadcastQueue();
+    Sample sample;
+    while (queue.pop(sample)) {
+        // Statistics see every sample, even ones coalesced out of the broadcast
+        statsEngine->add(sample.sensorId, sample.temperature, sample.epoch);
+        alertEngine->add(sample.sensorId, sample.temperature, sample.epoch);
+        webServerManager->broadcastTemperature(sample.temperature, sample.sensorId, sample.epoch, sample.flags);
+    }
+
+    // Only the newest reading per sensor goes out if samples piled up
+    webServerManager->flushBroadcasts();
+}
+
+void loop() {
+    resetManager->check();
+
+    applyLoggerSettings();
+
+    // Samples arrive from the acquisition task, each consumer drains its own queue
+    logSamples();
+    if (spiffsInitialized && dataLogger) {
+        dataLogger->update();
+    }
+    broadcastSamples();
+    alertEngine->check();
 
     delay(10);
 }
@@ -0,0 +1,82 @@
+#ifndef ARDUINO_STUB_H
+#define ARDUINO_STUB_H
+
+// Just enough of the Arduino core to build the libraries on the host, see
+// [env:native] in platformio.ini
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <limits.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+using std::min;
+using std::max;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+/**
+ * @brief Clock seen by millis(), following the host clock unless a test sets it
+ */
+struct FakeClock {
+    bool manual = false;
+    unsigned long now = 0;
+
+    void set(unsigned long ms) { manual = true; now = ms; }
+    void advance(unsigned long ms) { manual = true; now += ms; }
+    void release() { manual = false; }
+};
+
+inline FakeClock fakeClock;
+
+inline unsigned long hostMicros() {
+    static const auto start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long millis() { return fakeClock.manual ? fakeClock.now : hostMicros() / 1000; }
+inline unsigned long micros() { return fakeClock.manual ? fakeClock.now * 1000 : hostMicros(); }
+inline void delay(unsigned long ms) { fakeClock.advance(ms); }
+inline bool psramFound() { return false; }
+
+class String : public std::string {
+public:
+    String() {}
+    String(const char* text) : std::string(text) {}
+    String(const std::string& text) : std::string(text) {}
+    String(int value) : std::string(std::to_string(value)) {}
+    String(unsigned value) : std::string(std::to_string(value)) {}
+    String(long value) : std::string(std::to_string(value)) {}
+    String(unsigned long value) : std::string(std::to_string(value)) {}
+    String(float value, unsigned decimals = 2) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.*f", (int)decimals, value);
+        assign(text);
+    }
+    int toInt() const { return atoi(c_str()); }
+    bool isEmpty() const { return empty(); }
+};
+
+/**
+ * @brief Serial output, quiet unless a test turns it on
+ */
+struct HardwareSerial {
+    bool echo = false;
+
+    template<typename T> void print(const T& value) { if (echo) printf("%s", String(value).c_str()); }
+    template<typename T> void println(const T& value) { if (echo) printf("%s\n", String(value).c_str()); }
+    void println() { if (echo) printf("\n"); }
+    template<typename... Args> void printf(const char* format, Args... args) {
+        if (echo) ::printf(format, args...);
+    }
+};
+
+inline HardwareSerial Serial;
+
+#endif // ARDUINO_STUB_H
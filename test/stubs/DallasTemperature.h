@@ -0,0 +1,101 @@
+#ifndef DALLAS_TEMPERATURE_STUB_H
+#define DALLAS_TEMPERATURE_STUB_H
+
+// The part of the DallasTemperature API SensorManager uses, on FakeOneWireBus
+
+#include <OneWire.h>
+
+#define DEVICE_DISCONNECTED_C -127
+#define DS18S20MODEL 0x10
+
+typedef uint8_t DeviceAddress[8];
+
+class DallasTemperature {
+public:
+    struct request_t {
+        bool result;
+        unsigned long timestamp;
+    };
+
+    explicit DallasTemperature(OneWire* oneWire) { (void)oneWire; }
+
+    void begin() {}
+    void setWaitForConversion(bool wait) { waitForConversion = wait; }
+    void setAutoSaveScratchPad(bool save) { (void)save; }
+    uint8_t getDeviceCount() { return (uint8_t)fakeBus.probes.size(); }
+
+    bool getAddress(uint8_t* address, uint8_t index) {
+        if (index >= fakeBus.probes.size()) {
+            return false;
+        }
+        memcpy(address, fakeBus.probes[index].address, 8);
+        return true;
+    }
+
+    bool setResolution(const uint8_t* address, uint8_t bits, bool skipGlobalCalculation = false) {
+        (void)skipGlobalCalculation;
+        FakeProbe* probe = fakeBus.find(address);
+        if (!probe || !probe->connected) {
+            return false;
+        }
+        probe->resolution = bits;
+        fakeBus.resolutionWrites++;
+        return true;
+    }
+
+    request_t requestTemperatures() {
+        latchFinished();
+        uint8_t bits = 9;
+        for (const FakeProbe& probe : fakeBus.probes) {
+            bits = max(bits, probe.address[0] == DS18S20MODEL ? (uint8_t)12 : probe.resolution);
+        }
+        fakeBus.converting = true;
+        fakeBus.conversionStart = millis();
+        fakeBus.conversionTime = millisToWaitForConversion(bits);
+        fakeBus.conversions++;
+        if (waitForConversion) {
+            delay(fakeBus.conversionTime);
+        }
+        return { true, fakeBus.conversionStart };
+    }
+
+    bool isConversionComplete() { return !fakeBus.parasitePower && fakeBus.conversionDone(); }
+
+    float getTempC(const uint8_t* address) {
+        FakeProbe* probe = fakeBus.find(address);
+        if (!probe || !probe->connected) {
+            return DEVICE_DISCONNECTED_C;
+        }
+        if (!fakeBus.conversionDone()) {
+            fakeBus.earlyReads++;
+        }
+        latchFinished();
+        return probe->latched;
+    }
+
+    static uint16_t millisToWaitForConversion(uint8_t bits) {
+        switch (bits) {
+            case 9: return 94;
+            case 10: return 188;
+            case 11: return 375;
+            default: return 750;
+        }
+    }
+
+private:
+    bool waitForConversion = true;
+
+    // Results appear in the scratchpads once the conversion time has passed
+    static void latchFinished() {
+        if (!fakeBus.converting || !fakeBus.conversionDone()) {
+            return;
+        }
+        for (FakeProbe& probe : fakeBus.probes) {
+            float step = 1.0f / (1 << (probe.resolution - 8));
+            probe.latched = roundf(probe.temperature / step) * step;
+        }
+        fakeBus.converting = false;
+    }
+};
+
+#endif // DALLAS_TEMPERATURE_STUB_H
@@ -0,0 +1,91 @@
+#ifndef FS_STUB_H
+#define FS_STUB_H
+
+// Filesystem backed by a directory on the host
+
+#include <Arduino.h>
+#include <memory>
+#include <sys/stat.h>
+
+namespace fs {
+
+enum SeekMode { SeekSet = SEEK_SET, SeekCur = SEEK_CUR, SeekEnd = SEEK_END };
+
+class File {
+public:
+    File() {}
+    explicit File(FILE* handle) : handle(handle, fclose) {}
+
+    explicit operator bool() const { return (bool)handle; }
+
+    size_t write(const uint8_t* data, size_t size) { return handle ? fwrite(data, 1, size, handle.get()) : 0; }
+    size_t write(uint8_t value) { return write(&value, 1); }
+    size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+    size_t read(uint8_t* data, size_t size) { return handle ? fread(data, 1, size, handle.get()) : 0; }
+    int read() {
+        uint8_t value;
+        return read(&value, 1) == 1 ? value : -1;
+    }
+    int available() { return (int)(size() - position()); }
+    bool seek(uint32_t pos, SeekMode mode = SeekSet) { return handle && fseek(handle.get(), pos, mode) == 0; }
+    size_t position() const { return handle ? ftell(handle.get()) : 0; }
+    size_t size() const {
+        if (!handle) {
+            return 0;
+        }
+        long current = ftell(handle.get());
+        fseek(handle.get(), 0, SEEK_END);
+        long end = ftell(handle.get());
+        fseek(handle.get(), current, SEEK_SET);
+        return end;
+    }
+    void flush() {
+        if (handle) {
+            fflush(handle.get());
+        }
+    }
+    void close() { handle.reset(); }
+
+private:
+    std::shared_ptr<FILE> handle;
+};
+
+class FS {
+public:
+    explicit FS(const std::string& root) : root(root) {}
+
+    bool begin(bool formatOnFail = false) {
+        (void)formatOnFail;
+        mkdir(root.c_str(), 0755);
+        return true;
+    }
+
+    File open(const char* path, const char* mode = "r") {
+        std::string binary = std::string(mode) + "b";
+        FILE* handle = fopen((root + path).c_str(), binary.c_str());
+        return handle ? File(handle) : File();
+    }
+    File open(const String& path, const char* mode = "r") { return open(path.c_str(), mode); }
+
+    bool exists(const char* path) {
+        struct stat info;
+        return stat((root + path).c_str(), &info) == 0;
+    }
+    bool remove(const char* path) { return ::remove((root + path).c_str()) == 0; }
+    bool rename(const char* from, const char* to) { return ::rename((root + from).c_str(), (root + to).c_str()) == 0; }
+
+    size_t totalBytes() { return 1 << 20; }
+    size_t usedBytes() { return 0; }
+
+private:
+    std::string root;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif // FS_STUB_H
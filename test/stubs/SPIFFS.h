@@ -0,0 +1,8 @@
+#ifndef SPIFFS_STUB_H
+#define SPIFFS_STUB_H
+
+#include <FS.h>
+
+inline fs::FS SPIFFS(std::string(P_tmpdir) + "/iot-temperature-monitor-test");
+
+#endif // SPIFFS_STUB_H
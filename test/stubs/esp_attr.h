@@ -0,0 +1,7 @@
+#ifndef ESP_ATTR_STUB_H
+#define ESP_ATTR_STUB_H
+
+// RTC memory is ordinary RAM on the host, so nothing survives a "reset"
+#define RTC_NOINIT_ATTR
+
+#endif // ESP_ATTR_STUB_H
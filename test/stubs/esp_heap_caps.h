@@ -0,0 +1,16 @@
+#ifndef ESP_HEAP_CAPS_STUB_H
+#define ESP_HEAP_CAPS_STUB_H
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_8BIT (1 << 2)
+
+inline void* heap_caps_malloc(size_t size, uint32_t caps) {
+    (void)caps;
+    return malloc(size);
+}
+
+inline void heap_caps_free(void* ptr) { free(ptr); }
+
+#endif // ESP_HEAP_CAPS_STUB_H
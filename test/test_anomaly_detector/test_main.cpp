@@ -0,0 +1,205 @@
+#include <unity.h>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
+#include "AnomalyDetector.h"
+
+// Replays synthetic sensor traces with injected spikes, steps and drifts
+// through AnomalyDetector and measures how soon each is flagged
+
+static const uint16_t SPAN = 720;
+static const float THRESHOLD = 4.0f;
+static const uint32_t SAMPLE_SECONDS = 5;
+static const int DAY = 86400 / SAMPLE_SECONDS;
+static const int ONSET = 2000;      // Readings before an injected fault
+
+// A DS18B20 reading every 5 s: gaussian noise, quantized to 1/16 °C
+struct Sensor {
+    std::mt19937 random;
+    std::normal_distribution<float> noise;
+
+    Sensor(int seed) : random(seed), noise(0.0f, 0.05f) {}
+
+    float read(float celsius) {
+        return roundf((celsius + noise(random)) * 16) / 16;
+    }
+};
+
+static char message[160];
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_clean_traces_are_rarely_flagged() {
+    // Gaussian noise passes 4 standard deviations about once in 16000
+    // readings, so a day may see one or two false flags but no more
+    const char* names[] = { "flat freezer", "room with a daily cycle" };
+    for (int kind = 0; kind < 2; kind++) {
+        AnomalyDetector detector(SPAN, THRESHOLD);
+        Sensor sensor(1);
+        int flagged = 0;
+        for (int i = 0; i < DAY; i++) {
+            float celsius = kind == 0 ? -20.0f : 21.0f + 2.0f * sinf(i * 2 * M_PI / DAY);
+            flagged += detector.add(0, sensor.read(celsius)) != 0;
+        }
+        snprintf(message, sizeof(message), "%s: %d of %d readings flagged", names[kind], flagged, DAY);
+        TEST_MESSAGE(message);
+        TEST_ASSERT_TRUE_MESSAGE(flagged <= DAY / 5000, message);
+    }
+}
+
+void test_spikes_are_flagged_at_once() {
+    for (float height : { 0.5f, 1.0f, 3.0f }) {
+        AnomalyDetector detector(SPAN, THRESHOLD);
+        Sensor sensor(2);
+        int injected = 0;
+        int caught = 0;
+        int falseAlarms = 0;
+        for (int i = 0; i < DAY; i++) {
+            bool spike = i > 2 * SPAN && i % 500 == 250;
+            uint8_t flags = detector.add(0, sensor.read(-20.0f + (spike ? height : 0.0f)));
+            if (spike) {
+                injected++;
+                caught += (flags & ANOMALY_OUTLIER) != 0;
+            } else {
+                falseAlarms += (flags & ANOMALY_OUTLIER) != 0;
+            }
+        }
+        snprintf(message, sizeof(message), "%.1f C spikes: %d of %d flagged on the spike reading, %d false",
+                 height, caught, injected, falseAlarms);
+        TEST_MESSAGE(message);
+        TEST_ASSERT_EQUAL_MESSAGE(injected, caught, message);
+        TEST_ASSERT_EQUAL_MESSAGE(0, falseAlarms, message);
+    }
+}
+
+// Readings from the onset of a fault to the first flagged one, -1 if none
+static int detectionLatency(float (*fault)(int, float), float size, int readings) {
+    AnomalyDetector detector(SPAN, THRESHOLD);
+    Sensor sensor(3);
+    for (int i = 0; i < readings; i++) {
+        float offset = i >= ONSET ? fault(i - ONSET, size) : 0.0f;
+        uint8_t flags = detector.add(0, sensor.read(-20.0f + offset));
+        if (flags != 0) {
+            return i >= ONSET ? i - ONSET : -2;
+        }
+    }
+    return -1;
+}
+
+static float step(int, float size) {
+    return size;
+}
+
+static float drift(int elapsed, float perHour) {
+    return perHour * elapsed * SAMPLE_SECONDS / 3600.0f;
+}
+
+void test_steps_are_flagged_on_the_first_reading() {
+    for (float size : { 0.5f, 1.0f, 3.0f }) {
+        int latency = detectionLatency(step, size, 2 * ONSET);
+        snprintf(message, sizeof(message), "%.2f C step: flagged after %d readings", size, latency);
+        TEST_MESSAGE(message);
+        TEST_ASSERT_EQUAL_MESSAGE(0, latency, message);
+    }
+}
+
+void test_drifts_are_flagged_before_they_go_far() {
+    // Well before the drift reaches 1 °C, which the spikes above show is
+    // what a single reading is flagged for
+    for (float perHour : { 0.5f, 1.0f, 3.0f }) {
+        int latency = detectionLatency(drift, perHour, 4 * ONSET);
+        float off = drift(latency, perHour);
+        snprintf(message, sizeof(message), "%.1f C/h drift: flagged after %d readings (%lu s, %.2f C off)",
+                 perHour, latency, (unsigned long)(latency * SAMPLE_SECONDS), off);
+        TEST_MESSAGE(message);
+        TEST_ASSERT_TRUE_MESSAGE(latency >= 0, message);
+        TEST_ASSERT_TRUE_MESSAGE(off < 0.5f, message);
+    }
+}
+
+void test_new_parameters_apply_with_the_next_reading() {
+    AnomalyDetector detector(SPAN, THRESHOLD);
+    for (int i = 0; i < 100; i++) {
+        detector.add(0, 20.0f);
+    }
+
+    // Nothing changes until the acquisition side picks the new parameters up
+    detector.configure(10, 3.0f);
+    AnomalyDetector::State state;
+    TEST_ASSERT_TRUE(detector.getState(0, state));
+    TEST_ASSERT_EQUAL_UINT32(100, state.count);
+
+    detector.add(1, 25.0f);
+    TEST_ASSERT_TRUE(detector.getState(0, state));
+    TEST_ASSERT_EQUAL_UINT32(0, state.count);
+    TEST_ASSERT_TRUE(detector.getState(1, state));
+    TEST_ASSERT_EQUAL_UINT32(1, state.count);
+    TEST_ASSERT_EQUAL_FLOAT(25.0f, state.mean);
+
+    // With the shorter span the detector is warm after 10 readings
+    for (int i = 0; i < 11; i++) {
+        detector.add(1, 25.0f);
+    }
+    TEST_ASSERT_EQUAL_UINT8(ANOMALY_OUTLIER, detector.add(1, 26.0f) & ANOMALY_OUTLIER);
+}
+
+void test_state_reads_while_readings_are_added() {
+    // With a span of 1 both means follow each reading exactly, and readings
+    // rising by 1/16 °C stay below the outlier limit, so every published
+    // state has mean == fastMean == (count - 1) / 16. A state torn between
+    // two updates would break that.
+    const uint32_t READINGS = 200000;
+    AnomalyDetector detector(1, THRESHOLD);
+    std::atomic<bool> done(false);
+
+    std::thread writer([&]() {
+        for (uint32_t i = 0; i < READINGS; i++) {
+            detector.add(0, i / 16.0f);
+            if (i % 64 == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done.store(true);
+    });
+
+    uint32_t reads = 0;
+    uint32_t torn = 0;
+    uint32_t lastCount = 0;
+    while (!done.load()) {
+        AnomalyDetector::State state;
+        TEST_ASSERT_TRUE(detector.getState(0, state));
+        if (state.count > 0) {
+            float expected = (state.count - 1) / 16.0f;
+            torn += state.count < lastCount || state.mean != expected || state.fastMean != expected
+                || state.outliers != 0 || state.shifts != 0;
+        }
+        lastCount = state.count;
+        reads++;
+    }
+    writer.join();
+
+    AnomalyDetector::State state;
+    TEST_ASSERT_TRUE(detector.getState(0, state));
+    TEST_ASSERT_EQUAL_UINT32(READINGS, state.count);
+    TEST_ASSERT_EQUAL_FLOAT((READINGS - 1) / 16.0f, state.mean);
+    snprintf(message, sizeof(message), "%lu state reads during %lu readings, %lu inconsistent",
+             (unsigned long)reads, (unsigned long)READINGS, (unsigned long)torn);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_clean_traces_are_rarely_flagged);
+    RUN_TEST(test_spikes_are_flagged_at_once);
+    RUN_TEST(test_steps_are_flagged_on_the_first_reading);
+    RUN_TEST(test_drifts_are_flagged_before_they_go_far);
+    RUN_TEST(test_new_parameters_apply_with_the_next_reading);
+    RUN_TEST(test_state_reads_while_readings_are_added);
+    return UNITY_END();
+}
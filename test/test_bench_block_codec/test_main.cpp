@@ -0,0 +1,134 @@
+#include <unity.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "BlockCodec.h"
+#include "RingLog.h"
+
+// Bytes per sample and encode/decode throughput of TemperatureBlock on
+// realistic traces, against the 45-byte JSON entries the log used to hold
+
+struct Reading {
+    uint32_t epoch;
+    int16_t sixteenths;
+};
+
+static const uint32_t SAMPLES = 100000;
+static const int REPEATS = 20;
+static const double JSON_BYTES = 45.0;
+
+static int16_t sensorValue(double celsius) {
+    return (int16_t)lround(celsius * 16);
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::vector<TemperatureBlock> encode(const std::vector<Reading>& trace) {
+    std::vector<TemperatureBlock> blocks;
+    BlockEncoder encoder;
+    encoder.reset(0);
+    for (const Reading& reading : trace) {
+        if (!encoder.add(reading.epoch, reading.sixteenths)) {
+            blocks.push_back(encoder.getBlock());
+            encoder.reset(0);
+            encoder.add(reading.epoch, reading.sixteenths);
+        }
+    }
+    blocks.push_back(encoder.getBlock());
+    return blocks;
+}
+
+static void bench(const char* name, const std::vector<Reading>& trace) {
+    std::vector<TemperatureBlock> blocks;
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < REPEATS; i++) {
+        blocks = encode(trace);
+    }
+    double encodeSeconds = secondsSince(started) / REPEATS;
+
+    // Every reading must come back exactly
+    bool exact = true;
+    started = std::chrono::steady_clock::now();
+    for (int i = 0; i < REPEATS; i++) {
+        size_t index = 0;
+        for (const TemperatureBlock& block : blocks) {
+            BlockDecoder decoder(block);
+            uint32_t epoch;
+            int16_t sixteenths;
+            while (decoder.next(epoch, sixteenths)) {
+                exact = exact && index < trace.size() && trace[index].epoch == epoch &&
+                        trace[index].sixteenths == sixteenths;
+                index++;
+            }
+        }
+        exact = exact && index == trace.size();
+    }
+    double decodeSeconds = secondsSince(started) / REPEATS;
+    TEST_ASSERT_TRUE_MESSAGE(exact, name);
+
+    double bytesPerSample = (double)blocks.size() * sizeof(TemperatureBlock) / trace.size();
+    char message[192];
+    snprintf(message, sizeof(message),
+             "%s: %.2f B/sample, %.1fx the retention of JSON, %.1fx of the ring log, encode %.1f M/s, decode %.1f M/s",
+             name, bytesPerSample, JSON_BYTES / bytesPerSample, sizeof(LogRecord) / bytesPerSample,
+             trace.size() / encodeSeconds / 1e6, trace.size() / decodeSeconds / 1e6);
+    TEST_MESSAGE(message);
+
+    // The target: at least 10x the retention per flash KB of the JSON log
+    TEST_ASSERT_TRUE_MESSAGE(JSON_BYTES / bytesPerSample >= 10.0, name);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_benchmark_room_every_5_minutes() {
+    // Day/night cycle, sensor noise and a second or two of NTP jitter
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(0, 0.04);
+    std::vector<Reading> trace;
+    for (uint32_t i = 0; i < SAMPLES; i++) {
+        double hours = i * 300 / 3600.0;
+        double celsius = 21 + 1.5 * sin(hours / 24 * 2 * M_PI) + noise(rng);
+        trace.push_back({ 1700000000 + i * 300 + (uint32_t)(rng() % 3), sensorValue(celsius) });
+    }
+    bench("room, 5 min", trace);
+}
+
+void test_benchmark_heater_every_5_seconds() {
+    // Live sampling of a heater cycling on and off every hour
+    std::mt19937 rng(8);
+    std::normal_distribution<double> noise(0, 0.04);
+    std::vector<Reading> trace;
+    double celsius = 20;
+    for (uint32_t i = 0; i < SAMPLES; i++) {
+        bool heating = (i / 720) % 2;
+        celsius = constrain(celsius + (heating ? 0.01 : -0.008), 18.0, 28.0);
+        trace.push_back({ 1700000000 + i * 5, sensorValue(celsius + noise(rng)) });
+    }
+    bench("heater, 5 s", trace);
+}
+
+void test_benchmark_outdoor_with_gaps() {
+    // Outdoor probe every minute, with weather swings and dropouts
+    std::mt19937 rng(9);
+    std::normal_distribution<double> noise(0, 0.08);
+    std::vector<Reading> trace;
+    double celsius = 5;
+    uint32_t epoch = 1700000000;
+    for (uint32_t i = 0; i < SAMPLES; i++) {
+        epoch += rng() % 500 == 0 ? 600 + rng() % 3600 : 60;
+        celsius = constrain(celsius + noise(rng), -30.0, 40.0);
+        trace.push_back({ epoch, sensorValue(celsius) });
+    }
+    bench("outdoor, 60 s with gaps", trace);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_benchmark_room_every_5_minutes);
+    RUN_TEST(test_benchmark_heater_every_5_seconds);
+    RUN_TEST(test_benchmark_outdoor_with_gaps);
+    return UNITY_END();
+}
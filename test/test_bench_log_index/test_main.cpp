@@ -0,0 +1,116 @@
+#include <unity.h>
+#include <SPIFFS.h>
+#include <random>
+#include "RingLog.h"
+
+// Time lookups through the sparse epoch index against a full scan of the log
+
+static const char* PATH = "/test_index.bin";
+
+// Logical index of the first record with an epoch at or after the given one
+static uint32_t fullScan(RingLog& log, uint32_t epoch) {
+    RingLog::Reader reader = log.openReader();
+    LogRecord batch[256];
+    uint32_t index = 0;
+    size_t n;
+    while ((n = reader.read(batch, 256)) > 0) {
+        for (size_t i = 0; i < n; i++, index++) {
+            if (batch[i].epoch >= epoch) {
+                return index;
+            }
+        }
+    }
+    return index;
+}
+
+// Fills the log with readings 1-5 s apart and returns the newest epoch
+static uint32_t fill(RingLog& log, uint32_t total, std::mt19937& rng) {
+    uint32_t epoch = 1700000000;
+    for (uint32_t i = 0; i < total; i++) {
+        epoch += 1 + rng() % 5;
+        LogRecord record = { epoch, 2000, 0, 0 };
+        TEST_ASSERT_TRUE(log.append(&record));
+    }
+    return epoch;
+}
+
+struct Timing {
+    double scanMicros;
+    double indexedMicros;
+};
+
+// Compares both lookups for random targets, including ones outside the log
+static Timing compare(RingLog& log, uint32_t newest, int queries, std::mt19937& rng) {
+    RingLog::Reader reader = log.openReader();
+    Timing timing = { 0, 0 };
+    for (int q = 0; q < queries; q++) {
+        uint32_t target = 1700000000 - 10 + rng() % (newest - 1700000000 + 30);
+
+        unsigned long started = micros();
+        uint32_t expected = fullScan(log, target);
+        unsigned long scanned = micros();
+        uint32_t found = log.lowerBound(reader, target);
+        unsigned long indexed = micros();
+
+        timing.scanMicros += scanned - started;
+        timing.indexedMicros += indexed - scanned;
+        TEST_ASSERT_EQUAL_UINT32(expected, found);
+    }
+    timing.scanMicros /= queries;
+    timing.indexedMicros /= queries;
+    return timing;
+}
+
+void setUp() {
+    SPIFFS.begin();
+    SPIFFS.remove(PATH);
+}
+
+void tearDown() {
+    SPIFFS.remove(PATH);
+}
+
+void test_indexed_lookup_matches_full_scan() {
+    // Partial, exactly full and wrapped logs, with and without a partial last block
+    std::mt19937 rng(1);
+    const uint32_t capacities[] = { 1000, 1001 };
+    for (uint32_t capacity : capacities) {
+        const uint32_t totals[] = { 1, 5, capacity - 1, capacity, capacity + 7, capacity * 2 + 33 };
+        for (uint32_t total : totals) {
+            SPIFFS.remove(PATH);
+            uint32_t newest;
+            {
+                RingLog log(SPIFFS, PATH, capacity);
+                TEST_ASSERT_TRUE(log.begin());
+                newest = fill(log, total, rng);
+            }
+
+            // Reopen so the index is rebuilt from the file
+            RingLog log(SPIFFS, PATH, capacity);
+            TEST_ASSERT_TRUE(log.begin());
+            compare(log, newest, 500, rng);
+        }
+    }
+}
+
+void test_benchmark_100k_records() {
+    const uint32_t CAPACITY = 100000;
+    std::mt19937 rng(2);
+    RingLog log(SPIFFS, PATH, CAPACITY);
+    TEST_ASSERT_TRUE(log.begin());
+    uint32_t newest = fill(log, CAPACITY + CAPACITY / 3, rng);
+
+    Timing timing = compare(log, newest, 200, rng);
+    char message[128];
+    snprintf(message, sizeof(message), "100k records: full scan %.1f us, indexed %.1f us per lookup (%.0fx)",
+             timing.scanMicros, timing.indexedMicros, timing.scanMicros / fmax(timing.indexedMicros, 0.01));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE(timing.indexedMicros < timing.scanMicros);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_indexed_lookup_matches_full_scan);
+    RUN_TEST(test_benchmark_100k_records);
+    return UNITY_END();
+}
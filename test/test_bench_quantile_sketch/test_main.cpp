@@ -0,0 +1,142 @@
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "QuantileSketch.h"
+
+// Accuracy of the daily p50/p95/p99 estimate against exact quantiles, for a
+// day sampled every 5 s (the default) and every second, plus its cost
+
+static const uint32_t DAY_SAMPLES[] = { 17280, 86400 };
+static const double MAX_RANK_ERROR = 0.01;
+static const float SENSOR_STEP = 6.25f;    // 1/16 °C in 1/100 °C
+
+enum Trace {
+    NORMAL,
+    DAILY_CYCLE,
+    HEATING_SPIKES,
+    RAMP,
+    BIMODAL,
+    TRACE_COUNT
+};
+
+static const char* TRACE_NAMES[TRACE_COUNT] = {
+    "normal", "daily cycle", "heating spikes", "ramp", "bimodal"
+};
+
+// A day of readings in 1/100 °C, on the 1/16 °C grid of a DS18B20
+static std::vector<int16_t> makeDay(Trace trace, uint32_t samples, std::mt19937& random) {
+    std::normal_distribution<double> noise(0, 80);
+    std::vector<int16_t> day;
+    day.reserve(samples);
+    for (uint32_t i = 0; i < samples; i++) {
+        double x;
+        switch (trace) {
+            case NORMAL:
+                x = 2150 + noise(random);
+                break;
+            case DAILY_CYCLE:
+                x = 2100 + 300 * sin(2 * M_PI * i / samples) + random() % 20;
+                break;
+            case HEATING_SPIKES:
+                x = random() % 100 < 3 ? 2800 + random() % 400 : 2100 + random() % 30;
+                break;
+            case RAMP:
+                x = 1800 + i * 800.0 / samples;
+                break;
+            default:
+                x = (random() % 2 ? 1900 : 2500) + noise(random);
+                break;
+        }
+        day.push_back((int16_t)(lround(x / 6.25) * 6.25));
+    }
+    return day;
+}
+
+// How far p lies from the ranks of the reading nearest to the estimate
+static double rankError(const std::vector<int16_t>& sorted, float estimate, float p) {
+    auto above = std::lower_bound(sorted.begin(), sorted.end(), estimate);
+    if (above == sorted.end() || (above != sorted.begin() && estimate - above[-1] < *above - estimate)) {
+        --above;
+    }
+    double below = std::lower_bound(sorted.begin(), sorted.end(), *above) - sorted.begin();
+    double upTo = std::upper_bound(sorted.begin(), sorted.end(), *above) - sorted.begin();
+    double low = below / sorted.size();
+    double high = upTo / sorted.size();
+    return p < low ? low - p : p > high ? p - high : 0;
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_estimates_stay_close_to_exact_quantiles() {
+    std::mt19937 random(11);
+    char message[192];
+
+    for (uint32_t samples : DAY_SAMPLES) {
+        for (int t = 0; t < TRACE_COUNT; t++) {
+            std::vector<int16_t> day = makeDay((Trace)t, samples, random);
+            QuantileRecord record;
+            QuantileSketch::reset(record, 0);
+            for (int16_t value : day) {
+                QuantileSketch::add(record, value);
+            }
+
+            std::vector<int16_t> sorted = day;
+            std::sort(sorted.begin(), sorted.end());
+            TEST_ASSERT_EQUAL_UINT32(samples, record.count);
+            TEST_ASSERT_EQUAL_FLOAT(sorted.front(), QuantileSketch::getMin(record));
+            TEST_ASSERT_EQUAL_FLOAT(sorted.back(), QuantileSketch::getMax(record));
+
+            for (int q = 0; q < QUANTILE_COUNT; q++) {
+                float p = QuantileSketch::getProbability((Quantile)q);
+                float estimate = QuantileSketch::get(record, (Quantile)q);
+                float exact = sorted[(size_t)lround(p * (sorted.size() - 1))];
+                double error = rankError(sorted, estimate, p);
+                snprintf(message, sizeof(message),
+                         "%s, %lu samples: p%02d exact %.2f C, estimate %.2f C, off by %.2f C, rank error %.4f",
+                         TRACE_NAMES[t], (unsigned long)samples, (int)lroundf(p * 100),
+                         exact / 100, estimate / 100, fabsf(estimate - exact) / 100, error);
+                TEST_MESSAGE(message);
+                // Where readings crowd together a value off by less than the
+                // sensor's resolution can still be far off in rank
+                TEST_ASSERT_TRUE_MESSAGE(error <= MAX_RANK_ERROR || fabsf(estimate - exact) <= SENSOR_STEP, message);
+            }
+        }
+    }
+}
+
+void test_cost_per_sample() {
+    const uint32_t SAMPLES = 10000000;
+    std::mt19937 random(3);
+    std::vector<int16_t> values(4096);
+    for (int16_t& value : values) {
+        value = (int16_t)(2000 + random() % 300);
+    }
+
+    QuantileRecord record;
+    QuantileSketch::reset(record, 0);
+    auto started = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < SAMPLES; i++) {
+        QuantileSketch::add(record, values[i % values.size()]);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    TEST_ASSERT_EQUAL_UINT32(SAMPLES, record.count);
+
+    char message[128];
+    snprintf(message, sizeof(message), "%.1f ns per sample, %u bytes of state per day",
+             seconds / SAMPLES * 1e9, (unsigned)sizeof(QuantileRecord));
+    TEST_MESSAGE(message);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_estimates_stay_close_to_exact_quantiles);
+    RUN_TEST(test_cost_per_sample);
+    return UNITY_END();
+}
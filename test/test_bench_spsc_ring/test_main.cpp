@@ -0,0 +1,93 @@
+#include <unity.h>
+#include <chrono>
+#include <thread>
+#include "SpscRing.h"
+
+// Throughput of SpscRing with items the size of an acquisition Sample
+
+struct Item {
+    uint32_t epoch;
+    uint32_t tick;
+    float temperature;
+    uint8_t sensorId;
+    uint8_t flags;
+};
+
+static const uint32_t COUNT = 20000000;
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, double seconds) {
+    char message[96];
+    snprintf(message, sizeof(message), "%s: %.1f M items/s", name, COUNT / seconds / 1e6);
+    TEST_MESSAGE(message);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_benchmark_one_thread() {
+    // Push and pop in bursts from one thread: the cost of the operations alone
+    static SpscRing<Item, 64> ring;
+    uint32_t checksum = 0;
+    Item item = { 0, 0, 21.5f, 0, 0 };
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < COUNT; i += 32) {
+        for (uint32_t k = 0; k < 32; k++) {
+            item.tick = i + k;
+            ring.push(item);
+        }
+        while (ring.pop(item)) {
+            checksum += item.tick;
+        }
+    }
+    report("one thread, push + pop", secondsSince(start));
+
+    uint32_t expected = 0;
+    for (uint32_t i = 0; i < COUNT; i++) {
+        expected += i;
+    }
+    TEST_ASSERT_EQUAL_UINT32(expected, checksum);
+}
+
+void test_benchmark_two_threads() {
+    // Producer and consumer on separate threads, as acquisition and loop().
+    // Either side yields when it can't go on, so this also runs on one core.
+    static SpscRing<Item, 64> ring;
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        Item item = { 0, 0, 21.5f, 0, 0 };
+        for (uint32_t i = 0; i < COUNT;) {
+            item.tick = i;
+            if (ring.push(item)) {
+                i++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t received = 0;
+    bool ordered = true;
+    Item item;
+    while (received < COUNT) {
+        if (ring.pop(item)) {
+            ordered = ordered && item.tick == received;
+            received++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    report("two threads, producer to consumer", secondsSince(start));
+    TEST_ASSERT_TRUE(ordered);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_benchmark_one_thread);
+    RUN_TEST(test_benchmark_two_threads);
+    return UNITY_END();
+}
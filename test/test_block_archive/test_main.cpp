@@ -0,0 +1,180 @@
+#include <unity.h>
+#include <SPIFFS.h>
+#include <random>
+#include <vector>
+#include "BlockArchive.h"
+
+// Range queries and resume with sensors that fill their blocks at very
+// different rates, see BlockArchive
+
+static const char* ARCHIVE_PATH = "/test_archive.bin";
+static const char* LOG_PATH = "/test_archive_log.bin";
+static const uint32_t ARCHIVE_BLOCKS = 4096;
+static const uint32_t LOG_RECORDS = 40000;
+static const uint8_t SENSORS = 4;
+static const uint32_t START = 1700000000;
+
+// Sensor 0 is flat and, as with compression on, only logged every
+// SLOW_ROUNDS rounds; the others are noisy and logged every round, so they
+// seal dozens of blocks for each of its
+static const uint32_t SLOW_ROUNDS = 20;
+
+struct Feed {
+    std::mt19937 random;
+    uint32_t round;
+
+    Feed() : random(5), round(0) {}
+
+    uint32_t epoch() const {
+        return START + round * 5;
+    }
+
+    void next(std::vector<LogRecord>& records) {
+        records.clear();
+        for (uint8_t sensorId = 0; sensorId < SENSORS; sensorId++) {
+            if (sensorId == 0 && round % SLOW_ROUNDS != 0) {
+                continue;
+            }
+            LogRecord record;
+            record.epoch = epoch();
+            record.centiCelsius = sensorId == 0 ? 2000 : (int16_t)(1500 + random() % 2000);
+            record.sensorId = sensorId;
+            record.flags = 0;
+            records.push_back(record);
+        }
+        round++;
+    }
+};
+
+struct Reading {
+    uint32_t epoch;
+    int16_t sixteenths;
+
+    bool operator==(const Reading& other) const {
+        return epoch == other.epoch && sixteenths == other.sixteenths;
+    }
+};
+
+// Every reading in the first `count` blocks of the reader, per sensor
+static void decodeAll(RingLog::Reader reader, uint32_t count, std::vector<Reading>* readings) {
+    TemperatureBlock block;
+    while (count-- > 0 && reader.next(&block)) {
+        BlockDecoder decoder(block);
+        Reading reading;
+        while (decoder.next(reading.epoch, reading.sixteenths)) {
+            readings[block.sensorId].push_back(reading);
+        }
+    }
+}
+
+static void removeFiles() {
+    SPIFFS.remove(ARCHIVE_PATH);
+    SPIFFS.remove(LOG_PATH);
+}
+
+void setUp() {
+    SPIFFS.begin();
+    removeFiles();
+}
+
+void tearDown() {
+    removeFiles();
+}
+
+void test_range_query_returns_every_stored_reading() {
+    BlockArchive archive(SPIFFS, ARCHIVE_PATH, ARCHIVE_BLOCKS);
+    TEST_ASSERT_TRUE(archive.begin());
+    Feed feed;
+    std::vector<LogRecord> records;
+    while (feed.round < 40000) {
+        feed.next(records);
+        for (const LogRecord& record : records) {
+            TEST_ASSERT_TRUE(archive.add(record));
+        }
+    }
+
+    uint32_t count;
+    std::vector<Reading> stored[SENSORS];
+    RingLog::Reader reader = archive.openRangeReader(0, 0, count);
+    decodeAll(reader, count, stored);
+    TEST_ASSERT_TRUE(stored[0].size() >= 1000);
+
+    std::mt19937 random(9);
+    char message[96];
+    for (int query = 0; query < 200; query++) {
+        uint32_t from = START + random() % (feed.epoch() - START);
+        uint32_t to = from + random() % 30000;
+        std::vector<Reading> returned[SENSORS];
+        reader = archive.openRangeReader(from, to, count);
+        decodeAll(reader, count, returned);
+
+        for (uint8_t sensor = 0; sensor < SENSORS; sensor++) {
+            std::vector<Reading> expected;
+            std::vector<Reading> got;
+            for (const Reading& reading : stored[sensor]) {
+                if (reading.epoch >= from && reading.epoch <= to) {
+                    expected.push_back(reading);
+                }
+            }
+            for (const Reading& reading : returned[sensor]) {
+                if (reading.epoch >= from && reading.epoch <= to) {
+                    got.push_back(reading);
+                }
+            }
+            snprintf(message, sizeof(message), "sensor %u from %lu to %lu", sensor,
+                     (unsigned long)from, (unsigned long)to);
+            TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected.size(), got.size(), message);
+            TEST_ASSERT_TRUE_MESSAGE(expected == got, message);
+        }
+    }
+}
+
+void test_resume_keeps_readings_of_slowly_filling_sensors() {
+    RingLog log(SPIFFS, LOG_PATH, LOG_RECORDS);
+    TEST_ASSERT_TRUE(log.begin());
+    Feed feed;
+    std::vector<Reading> fed[SENSORS];
+    std::vector<LogRecord> records;
+    auto feedBoth = [&](BlockArchive& archive, uint32_t rounds) {
+        for (uint32_t i = 0; i < rounds; i++) {
+            feed.next(records);
+            for (const LogRecord& record : records) {
+                TEST_ASSERT_TRUE(log.append(&record));
+                TEST_ASSERT_TRUE(archive.add(record));
+                fed[record.sensorId].push_back({ record.epoch, BlockEncoder::toSixteenths(record.centiCelsius) });
+            }
+        }
+    };
+
+    {
+        BlockArchive archive(SPIFFS, ARCHIVE_PATH, ARCHIVE_BLOCKS);
+        TEST_ASSERT_TRUE(archive.begin());
+        feedBoth(archive, 3000);
+    }
+
+    // After a reboot the open blocks are rebuilt from the raw log
+    BlockArchive archive(SPIFFS, ARCHIVE_PATH, ARCHIVE_BLOCKS);
+    TEST_ASSERT_TRUE(archive.begin());
+    archive.resume(log);
+    feedBoth(archive, 3000);
+
+    // Each sensor's stored readings are the start of what it was fed, no
+    // reading lost or stored twice
+    uint32_t count;
+    std::vector<Reading> stored[SENSORS];
+    RingLog::Reader reader = archive.openRangeReader(0, 0, count);
+    decodeAll(reader, count, stored);
+    for (uint8_t sensor = 0; sensor < SENSORS; sensor++) {
+        TEST_ASSERT_TRUE(stored[sensor].size() >= 200);
+        TEST_ASSERT_TRUE(stored[sensor].size() <= fed[sensor].size());
+        std::vector<Reading> prefix(fed[sensor].begin(), fed[sensor].begin() + stored[sensor].size());
+        TEST_ASSERT_TRUE(prefix == stored[sensor]);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_range_query_returns_every_stored_reading);
+    RUN_TEST(test_resume_keeps_readings_of_slowly_filling_sensors);
+    return UNITY_END();
+}
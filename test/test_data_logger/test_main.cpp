@@ -0,0 +1,118 @@
+#include <unity.h>
+#include <SPIFFS.h>
+#include <cmath>
+#include <random>
+#include "AnomalyDetector.h"
+#include "DataLogger.h"
+
+// Log order and flagged readings with compression on, see DataLogger
+
+static const char* PATHS[] = {
+    "/test_log.bin", "/temperature_archive.bin", "/rollup_minute.bin", "/rollup_hour.bin",
+    "/rollup_day.bin", "/rollup_day_quantiles.bin"
+};
+static const uint32_t LOG_RECORDS = 20000;
+static const uint32_t CACHE_RECORDS = 1024;
+static const uint32_t START = 1700000000;
+
+static void removeFiles() {
+    for (const char* path : PATHS) {
+        SPIFFS.remove(path);
+    }
+}
+
+void setUp() {
+    SPIFFS.begin();
+    removeFiles();
+}
+
+void tearDown() {
+    removeFiles();
+}
+
+void test_log_stays_in_time_order_with_compression() {
+    DataLogger logger(PATHS[0], 5, LOG_RECORDS, CACHE_RECORDS);
+    TEST_ASSERT_TRUE(logger.begin());
+    logger.setCompression(true, 0.1f, 900);
+
+    // Filtered sensors 0-7 from flat to noisy, some skipping rounds, plus
+    // sensor 9 which is logged unfiltered
+    std::mt19937 random(7);
+    const uint8_t sensors[] = { 0, 1, 2, 3, 4, 5, 6, 7, 9 };
+    for (uint32_t round = 0; round < 5000; round++) {
+        uint32_t epoch = START + round * 5;
+        for (uint8_t sensorId : sensors) {
+            if (sensorId % 3 == 1 && random() % 4 == 0) {
+                continue;
+            }
+            float noise = (random() % 100) / 100.0f * sensorId / 4;
+            float celsius = 20.0f + 3.0f * sinf(round / 200.0f + sensorId) + noise;
+            TEST_ASSERT_TRUE(logger.logTemperature(celsius, sensorId, epoch));
+        }
+    }
+    TEST_ASSERT_TRUE(logger.flush());
+    TEST_ASSERT_TRUE(logger.getSamplesLogged() < logger.getSamplesOffered());
+
+    uint32_t count;
+    RingLog::Reader reader = logger.openRangeReader(0, 0, 0, count);
+    TEST_ASSERT_TRUE(count > CACHE_RECORDS);
+    LogRecord record;
+    uint32_t last = 0;
+    uint32_t inversions = 0;
+    while (count-- > 0 && reader.next(&record)) {
+        inversions += record.epoch < last;
+        last = record.epoch;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, inversions);
+
+    // A reading older than the newest one would have emptied the cache
+    TEST_ASSERT_EQUAL_UINT32(CACHE_RECORDS, logger.getCache()->size());
+}
+
+void test_flagged_readings_are_logged_unchanged() {
+    DataLogger logger(PATHS[0], 5, LOG_RECORDS, CACHE_RECORDS);
+    TEST_ASSERT_TRUE(logger.begin());
+    logger.setCompression(true, 0.5f, 900);
+
+    // A slow ramp the filter covers with few readings, and a flagged reading
+    // within its tolerance that it would have moved or left out
+    const uint32_t FLAGGED = 100;
+    for (uint32_t round = 0; round < 200; round++) {
+        float celsius = 20.0f + round * 0.001f;
+        uint8_t flags = 0;
+        if (round == FLAGGED) {
+            celsius += 0.3f;
+            flags = ANOMALY_OUTLIER;
+        }
+        TEST_ASSERT_TRUE(logger.logTemperature(celsius, 0, START + round * 5, flags));
+    }
+    TEST_ASSERT_TRUE(logger.flush());
+
+    uint32_t count;
+    RingLog::Reader reader = logger.openRangeReader(0, 0, 0, count);
+    TEST_ASSERT_TRUE(count < 20);
+    LogRecord record;
+    LogRecord before = {};
+    bool found = false;
+    while (!found && count-- > 0 && reader.next(&record)) {
+        found = record.epoch == START + FLAGGED * 5;
+        if (!found) {
+            before = record;
+        }
+    }
+    TEST_ASSERT_TRUE(found);
+    TEST_ASSERT_EQUAL_INT16(2040, record.centiCelsius);
+    TEST_ASSERT_EQUAL_UINT8(ANOMALY_OUTLIER, record.flags);
+
+    // The reading the filter held back is logged too, so the ramp up to the
+    // flagged reading is still there
+    TEST_ASSERT_EQUAL_UINT32(START + (FLAGGED - 1) * 5, before.epoch);
+    TEST_ASSERT_EQUAL_UINT8(0, before.flags);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_log_stays_in_time_order_with_compression);
+    RUN_TEST(test_flagged_readings_are_logged_unchanged);
+    return UNITY_END();
+}
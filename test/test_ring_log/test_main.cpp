@@ -0,0 +1,173 @@
+#include <unity.h>
+#include <SPIFFS.h>
+#include <atomic>
+#include <thread>
+#include "RingLog.h"
+
+// Appends to a fixed-size ring and wraparound, see RingLog
+
+static const char* PATH = "/test_ring.bin";
+static const uint32_t CAPACITY = 1000;
+static const uint32_t APPENDS = 12000;
+
+static LogRecord makeRecord(uint32_t i) {
+    LogRecord record;
+    record.epoch = 1700000000 + i * 5;
+    record.centiCelsius = (int16_t)(2000 + i % 500);
+    record.sensorId = i % 3;
+    record.flags = 0;
+    return record;
+}
+
+// The reader must return exactly records [first, first + count) in order
+static void assertContents(RingLog& log, uint32_t first, uint32_t count) {
+    TEST_ASSERT_EQUAL_UINT32(count, log.size());
+    RingLog::Reader reader = log.openReader();
+    TEST_ASSERT_TRUE(reader.isValid());
+    TEST_ASSERT_EQUAL_UINT32(count, reader.size());
+
+    LogRecord record;
+    for (uint32_t i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(reader.next(&record));
+        LogRecord expected = makeRecord(first + i);
+        TEST_ASSERT_EQUAL_MEMORY(&expected, &record, sizeof(record));
+    }
+    TEST_ASSERT_FALSE(reader.next(&record));
+}
+
+void setUp() {
+    SPIFFS.begin();
+    SPIFFS.remove(PATH);
+}
+
+void tearDown() {
+    SPIFFS.remove(PATH);
+}
+
+void test_partial_log_keeps_every_record() {
+    RingLog log(SPIFFS, PATH, CAPACITY);
+    TEST_ASSERT_TRUE(log.begin());
+    for (uint32_t i = 0; i < 300; i++) {
+        LogRecord record = makeRecord(i);
+        TEST_ASSERT_TRUE(log.append(&record));
+    }
+    assertContents(log, 0, 300);
+}
+
+void test_append_cost_does_not_grow_with_the_log() {
+    RingLog log(SPIFFS, PATH, CAPACITY);
+    TEST_ASSERT_TRUE(log.begin());
+
+    // Every append writes one slot plus the header, however full the log is
+    const uint32_t appendBytes = sizeof(LogRecord) + RingLog::getHeaderSize();
+    unsigned long firstLap = 0;
+    unsigned long lastLap = 0;
+    for (uint32_t i = 0; i < APPENDS; i++) {
+        LogRecord record = makeRecord(i);
+        uint32_t before = log.getBytesWritten();
+        unsigned long started = micros();
+        TEST_ASSERT_TRUE(log.append(&record));
+        unsigned long took = micros() - started;
+        TEST_ASSERT_EQUAL_UINT32(appendBytes, log.getBytesWritten() - before);
+
+        if (i < CAPACITY) {
+            firstLap += took;
+        } else if (i >= APPENDS - CAPACITY) {
+            lastLap += took;
+        }
+    }
+
+    // The file never grows past one lap of slots
+    File file = SPIFFS.open(PATH, "r");
+    TEST_ASSERT_EQUAL_UINT32(RingLog::getHeaderSize() + CAPACITY * sizeof(LogRecord), file.size());
+
+    char message[96];
+    snprintf(message, sizeof(message), "append: %.2f us during the first lap, %.2f us during the last",
+             (double)firstLap / CAPACITY, (double)lastLap / CAPACITY);
+    TEST_MESSAGE(message);
+}
+
+void test_wraparound_keeps_the_newest_records() {
+    RingLog log(SPIFFS, PATH, CAPACITY);
+    TEST_ASSERT_TRUE(log.begin());
+    for (uint32_t i = 0; i < APPENDS; i++) {
+        LogRecord record = makeRecord(i);
+        TEST_ASSERT_TRUE(log.append(&record));
+
+        // Check around each wrap, when the head goes back to slot 0
+        if ((i + 1) % CAPACITY == 0 || (i + 1) % CAPACITY == 1) {
+            uint32_t kept = min(i + 1, CAPACITY);
+            assertContents(log, i + 1 - kept, kept);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(APPENDS, log.getSequence());
+
+    LogRecord last;
+    TEST_ASSERT_TRUE(log.readLast(&last));
+    TEST_ASSERT_EQUAL_UINT32(makeRecord(APPENDS - 1).epoch, last.epoch);
+}
+
+void test_reopened_log_continues_after_wraparound() {
+    {
+        RingLog log(SPIFFS, PATH, CAPACITY);
+        TEST_ASSERT_TRUE(log.begin());
+        for (uint32_t i = 0; i < APPENDS + 123; i++) {
+            LogRecord record = makeRecord(i);
+            TEST_ASSERT_TRUE(log.append(&record));
+        }
+    }
+
+    RingLog log(SPIFFS, PATH, CAPACITY);
+    TEST_ASSERT_TRUE(log.begin());
+    assertContents(log, APPENDS + 123 - CAPACITY, CAPACITY);
+
+    for (uint32_t i = APPENDS + 123; i < APPENDS + 500; i++) {
+        LogRecord record = makeRecord(i);
+        TEST_ASSERT_TRUE(log.append(&record));
+    }
+    assertContents(log, APPENDS + 500 - CAPACITY, CAPACITY);
+    TEST_ASSERT_EQUAL_UINT32(APPENDS + 500, log.getSequence());
+}
+
+void test_readers_while_appending_and_resizing() {
+    // The web server opens and searches readers while loop() appends and
+    // resizes; run under ThreadSanitizer to check the locking
+    RingLog log(SPIFFS, PATH, 200);
+    TEST_ASSERT_TRUE(log.begin());
+    std::atomic<bool> done(false);
+
+    std::thread writer([&] {
+        const uint32_t retentions[] = { 200, 50, 700, 33, 1000 };
+        for (uint32_t i = 0; i < 20000; i++) {
+            LogRecord record = makeRecord(i);
+            log.append(&record);
+            if (i % 997 == 0) {
+                log.setRetention(retentions[(i / 997) % 5]);
+            }
+        }
+        done = true;
+    });
+
+    uint32_t queries = 0;
+    bool consistent = true;
+    while (!done) {
+        uint32_t from = makeRecord(queries * 7 % 20000).epoch;
+        uint32_t count;
+        RingLog::Reader reader = log.openRangeReader(from, from + 3000, 0, count);
+        consistent = consistent && reader.size() <= 1000 && count <= reader.size();
+        queries++;
+    }
+    writer.join();
+    TEST_ASSERT_TRUE(consistent);
+    TEST_ASSERT_TRUE(queries > 0);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_partial_log_keeps_every_record);
+    RUN_TEST(test_append_cost_does_not_grow_with_the_log);
+    RUN_TEST(test_wraparound_keeps_the_newest_records);
+    RUN_TEST(test_reopened_log_continues_after_wraparound);
+    RUN_TEST(test_readers_while_appending_and_resizing);
+    return UNITY_END();
+}
@@ -0,0 +1,137 @@
+#include <unity.h>
+#include <SPIFFS.h>
+#include "RollupStore.h"
+
+// Bucket counts past 16 bits, the tier file layout and the daily
+// quantiles, see RollupStore
+
+static const char* PATHS[] = {
+    "/rollup_minute.bin", "/rollup_hour.bin", "/rollup_day.bin", "/rollup_day_quantiles.bin"
+};
+static const uint32_t DAY_START = 1700006400;  // Midnight UTC
+
+static void removeFiles() {
+    for (const char* path : PATHS) {
+        SPIFFS.remove(path);
+    }
+}
+
+static int16_t readingAt(uint32_t i) {
+    return (int16_t)(1500 + i % 1000);
+}
+
+void setUp() {
+    SPIFFS.begin();
+    removeFiles();
+}
+
+void tearDown() {
+    removeFiles();
+}
+
+void test_busy_day_stays_one_bucket() {
+    // Two readings a second for most of a day, well past UINT16_MAX
+    const uint32_t readings = 150000;
+    int64_t sum = 0;
+    {
+        RollupStore store(SPIFFS);
+        TEST_ASSERT_TRUE(store.begin());
+        for (uint32_t i = 0; i < readings; i++) {
+            TEST_ASSERT_TRUE(store.add(DAY_START + i / 2, readingAt(i)));
+            sum += readingAt(i);
+        }
+        TEST_ASSERT_TRUE(store.flush());
+    }
+
+    // Reopened, the day must be a single row holding every reading
+    RollupStore store(SPIFFS);
+    TEST_ASSERT_TRUE(store.begin());
+    uint32_t count;
+    RingLog::Reader reader = store.openRangeReader(ROLLUP_DAY, 0, 0, 0, count);
+    TEST_ASSERT_EQUAL_UINT32(1, count);
+
+    RollupRecord day;
+    TEST_ASSERT_TRUE(reader.next(&day));
+    TEST_ASSERT_EQUAL_UINT32(DAY_START, day.epoch);
+    TEST_ASSERT_EQUAL_UINT32(readings, day.count);
+    TEST_ASSERT_EQUAL_INT16(1500, day.minCentiCelsius);
+    TEST_ASSERT_EQUAL_INT16(2499, day.maxCentiCelsius);
+    TEST_ASSERT_EQUAL_INT32((int32_t)sum, day.sumCentiCelsius);
+    TEST_ASSERT_FALSE(reader.next(&day));
+
+    // Hours are 7200 readings each, 150000 readings span 20.8 of them
+    reader = store.openRangeReader(ROLLUP_HOUR, 0, 0, 0, count);
+    TEST_ASSERT_EQUAL_UINT32(21, count);
+    RollupRecord hour;
+    TEST_ASSERT_TRUE(reader.next(&hour));
+    TEST_ASSERT_EQUAL_UINT32(DAY_START, hour.epoch);
+    TEST_ASSERT_EQUAL_UINT32(7200, hour.count);
+}
+
+void test_tiers_with_the_old_layout_are_reformatted() {
+    // 16-byte records with 16-bit counts, as written before the layout change
+    const size_t OLD_RECORD_SIZE = 16;
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        RingLog old(SPIFFS, PATHS[t], 100, OLD_RECORD_SIZE);
+        TEST_ASSERT_TRUE(old.begin());
+        uint8_t record[OLD_RECORD_SIZE] = {};
+        uint32_t epoch = DAY_START;
+        memcpy(record, &epoch, sizeof(epoch));
+        TEST_ASSERT_TRUE(old.append(record));
+    }
+
+    RollupStore store(SPIFFS);
+    TEST_ASSERT_TRUE(store.begin());
+    for (int t = 0; t < ROLLUP_TIER_COUNT; t++) {
+        uint32_t count;
+        store.openRangeReader((RollupTier)t, 0, 0, 0, count);
+        TEST_ASSERT_EQUAL_UINT32(0, count);
+    }
+
+    // And take new readings as usual
+    TEST_ASSERT_TRUE(store.add(DAY_START, 2000));
+    TEST_ASSERT_TRUE(store.flush());
+    RollupRecord buckets[ROLLUP_TIER_COUNT];
+    store.getOpenBuckets(buckets);
+    TEST_ASSERT_EQUAL_UINT32(1, buckets[ROLLUP_DAY].count);
+}
+
+void test_quantiles_count_every_sample() {
+    // Samples every 5 s, one in 60 of them logged
+    const uint32_t samples = 17280;
+    {
+        RollupStore store(SPIFFS);
+        TEST_ASSERT_TRUE(store.begin());
+        for (uint32_t i = 0; i < samples; i++) {
+            uint32_t epoch = DAY_START + i * 5;
+            TEST_ASSERT_TRUE(store.addQuantile(epoch, readingAt(i)));
+            if (i % 60 == 0) {
+                TEST_ASSERT_TRUE(store.add(epoch, readingAt(i)));
+            }
+        }
+        TEST_ASSERT_TRUE(store.flush());
+    }
+
+    RollupStore store(SPIFFS);
+    TEST_ASSERT_TRUE(store.begin());
+    uint32_t count;
+    RingLog::Reader reader = store.openQuantileReader(0, 0, 0, count);
+    TEST_ASSERT_EQUAL_UINT32(1, count);
+    QuantileRecord day;
+    TEST_ASSERT_TRUE(reader.next(&day));
+    TEST_ASSERT_EQUAL_UINT32(DAY_START, day.epoch);
+    TEST_ASSERT_EQUAL_UINT32(samples, day.count);
+
+    reader = store.openRangeReader(ROLLUP_DAY, 0, 0, 0, count);
+    RollupRecord bucket;
+    TEST_ASSERT_TRUE(reader.next(&bucket));
+    TEST_ASSERT_EQUAL_UINT32(samples / 60, bucket.count);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_busy_day_stays_one_bucket);
+    RUN_TEST(test_tiers_with_the_old_layout_are_reformatted);
+    RUN_TEST(test_quantiles_count_every_sample);
+    return UNITY_END();
+}
@@ -0,0 +1,190 @@
+#include <unity.h>
+#include "SensorManager.h"
+
+// The non-blocking conversion state machine on a fake OneWire bus and clock,
+// see test/stubs/OneWire.h
+
+static const unsigned long START = 100000;
+
+static SensorManager* sensors;
+
+// Runs update() every 10 ms of fake time, as the acquisition task polls it
+static void run(unsigned long ms) {
+    for (unsigned long t = 0; t < ms; t += 10) {
+        fakeClock.advance(10);
+        sensors->update();
+    }
+}
+
+void setUp() {
+    fakeBus.reset();
+    fakeClock.set(START);
+    sensors = nullptr;
+}
+
+void tearDown() {
+    delete sensors;
+    fakeClock.release();
+}
+
+void test_begin_starts_a_conversion_without_waiting() {
+    fakeBus.add(21.5f);
+    sensors = new SensorManager(19, 1000);
+    TEST_ASSERT_TRUE(sensors->begin());
+
+    TEST_ASSERT_EQUAL_UINT32(START, millis());
+    TEST_ASSERT_EQUAL_UINT32(1, fakeBus.conversions);
+    TEST_ASSERT_EQUAL_UINT32(ULONG_MAX, sensors->getReadingAge());
+    TEST_ASSERT_FALSE(sensors->isSensorWorking());
+}
+
+void test_update_returns_while_converting() {
+    fakeBus.add(21.5f);
+    sensors = new SensorManager(19, 1000);
+    sensors->begin();
+
+    run(700);
+    TEST_ASSERT_EQUAL_UINT32(START + 700, millis());
+    TEST_ASSERT_EQUAL_UINT32(ULONG_MAX, sensors->getReadingAge());
+
+    run(60);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.5f, sensors->getTemperature());
+    TEST_ASSERT_TRUE(sensors->isSensorWorking());
+    TEST_ASSERT_EQUAL_UINT32(0, fakeBus.earlyReads);
+}
+
+void test_parasite_power_reads_after_the_datasheet_time() {
+    fakeBus.add(19.0f);
+    fakeBus.parasitePower = true;
+    sensors = new SensorManager(19, 1000);
+    sensors->begin();
+
+    run(740);
+    TEST_ASSERT_EQUAL_UINT32(ULONG_MAX, sensors->getReadingAge());
+    run(20);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 19.0f, sensors->getTemperature());
+    TEST_ASSERT_EQUAL_UINT32(0, fakeBus.earlyReads);
+}
+
+void test_cached_value_and_age_without_touching_the_bus() {
+    fakeBus.add(20.0f);
+    sensors = new SensorManager(19, 1000);
+    sensors->begin();
+    run(760);
+
+    // Readers get the cached value, whatever the probe measures now
+    fakeBus.probes[0].temperature = 30.0f;
+    unsigned long age = sensors->getReadingAge();
+    fakeClock.advance(400);
+    uint32_t conversions = fakeBus.conversions;
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 20.0f, sensors->getTemperature());
+    TEST_ASSERT_EQUAL_UINT32(age + 400, sensors->getReadingAge());
+    TEST_ASSERT_EQUAL_UINT32(conversions, fakeBus.conversions);
+
+    // The next conversion starts one interval after the previous one
+    run(1000);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 30.0f, sensors->getTemperature());
+}
+
+void test_probes_are_read_by_address() {
+    fakeBus.add(18.0f);
+    fakeBus.add(22.5f);
+    fakeBus.add(-4.25f);
+    sensors = new SensorManager(19, 1000);
+    sensors->begin();
+    run(760);
+
+    TEST_ASSERT_EQUAL_UINT8(3, sensors->getSensorCount());
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 18.0f, sensors->getTemperature(0));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 22.5f, sensors->getTemperature(1));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -4.25f, sensors->getTemperature(2));
+    TEST_ASSERT_EQUAL_UINT32(1, fakeBus.conversions);
+}
+
+void test_disconnected_probe_keeps_its_last_good_value() {
+    fakeBus.add(20.0f);
+    fakeBus.add(21.0f);
+    sensors = new SensorManager(19, 1000);
+    sensors->begin();
+    run(760);
+
+    fakeBus.probes[1].connected = false;
+    run(1000);
+    TEST_ASSERT_TRUE(sensors->isSensorWorking(0));
+    TEST_ASSERT_FALSE(sensors->isSensorWorking(1));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.0f, sensors->getTemperature(1));
+
+    fakeBus.probes[1].connected = true;
+    run(1000);
+    TEST_ASSERT_TRUE(sensors->isSensorWorking(1));
+}
+
+// Moves the clock until the reading is exactly the given age
+static void ageReading(unsigned long age) {
+    fakeClock.advance(age - sensors->getReadingAge());
+}
+
+void test_stale_limit_follows_the_reading_interval() {
+    fakeBus.add(20.0f);
+    sensors = new SensorManager(19, 60000);
+    sensors->begin();
+    run(760);
+    TEST_ASSERT_TRUE(sensors->isSensorWorking());
+
+    // Between conversions 60 s apart the probe still counts as working,
+    // until two conversions in a row are overdue
+    ageReading(59000);
+    TEST_ASSERT_TRUE(sensors->isSensorWorking());
+    ageReading(2 * 60000 + 750);
+    TEST_ASSERT_TRUE(sensors->isSensorWorking());
+    ageReading(2 * 60000 + 751);
+    TEST_ASSERT_FALSE(sensors->isSensorWorking());
+
+    // A shorter interval gives a shorter limit
+    sensors->setReadingInterval(1000);
+    run(2000);
+    TEST_ASSERT_TRUE(sensors->isSensorWorking());
+    ageReading(2 * 1000 + 750);
+    TEST_ASSERT_TRUE(sensors->isSensorWorking());
+    ageReading(2 * 1000 + 751);
+    TEST_ASSERT_FALSE(sensors->isSensorWorking());
+}
+
+void test_resolution_change_waits_for_the_running_conversion() {
+    fakeBus.add(20.0f);
+    fakeBus.parasitePower = true;
+    sensors = new SensorManager(19, 1000);
+    sensors->begin();
+    run(100);
+
+    // Lowering the resolution mid-conversion must not cut the 12-bit one short
+    sensors->setResolutionPolicy(false, 9);
+    TEST_ASSERT_EQUAL_UINT8(12, sensors->getResolution());
+    TEST_ASSERT_EQUAL_UINT8(12, fakeBus.probes[0].resolution);
+    run(660);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 20.0f, sensors->getTemperature());
+    TEST_ASSERT_EQUAL_UINT32(0, fakeBus.earlyReads);
+
+    // The probes get the new resolution once the bus is idle
+    TEST_ASSERT_EQUAL_UINT8(9, sensors->getResolution());
+    TEST_ASSERT_EQUAL_UINT8(9, fakeBus.probes[0].resolution);
+    TEST_ASSERT_EQUAL_UINT32(94, sensors->getConversionTime());
+
+    fakeBus.probes[0].temperature = 20.3f;
+    run(1000);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 20.5f, sensors->getTemperature());
+    TEST_ASSERT_EQUAL_UINT32(0, fakeBus.earlyReads);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_starts_a_conversion_without_waiting);
+    RUN_TEST(test_update_returns_while_converting);
+    RUN_TEST(test_parasite_power_reads_after_the_datasheet_time);
+    RUN_TEST(test_cached_value_and_age_without_touching_the_bus);
+    RUN_TEST(test_probes_are_read_by_address);
+    RUN_TEST(test_disconnected_probe_keeps_its_last_good_value);
+    RUN_TEST(test_stale_limit_follows_the_reading_interval);
+    RUN_TEST(test_resolution_change_waits_for_the_running_conversion);
+    return UNITY_END();
+}
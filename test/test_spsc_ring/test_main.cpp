@@ -0,0 +1,123 @@
+#include <unity.h>
+#include <thread>
+#include "SpscRing.h"
+
+// Single-threaded behaviour and a two-thread ordering check of SpscRing
+
+struct Item {
+    uint32_t sequence;
+    float value;
+    uint8_t tag;
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_empty_ring_pops_nothing() {
+    SpscRing<int, 8> ring;
+    int item;
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_EQUAL_UINT32(0, ring.size());
+    TEST_ASSERT_FALSE(ring.pop(item));
+}
+
+void test_holds_capacity_minus_one() {
+    SpscRing<int, 8> ring;
+    TEST_ASSERT_EQUAL_UINT32(7, ring.capacity());
+    for (int i = 0; i < 7; i++) {
+        TEST_ASSERT_TRUE(ring.push(i));
+        TEST_ASSERT_EQUAL_UINT32(i + 1, ring.size());
+    }
+    TEST_ASSERT_FALSE(ring.push(99));
+    TEST_ASSERT_EQUAL_UINT32(7, ring.size());
+
+    // A full ring still returns every item, oldest first
+    int item;
+    for (int i = 0; i < 7; i++) {
+        TEST_ASSERT_TRUE(ring.pop(item));
+        TEST_ASSERT_EQUAL_INT(i, item);
+    }
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_indices_wrap_around() {
+    SpscRing<Item, 4> ring;
+    Item item;
+    for (uint32_t i = 0; i < 1000; i++) {
+        TEST_ASSERT_TRUE(ring.push({ i, i * 0.5f, (uint8_t)(i % 7) }));
+        if (i % 3 == 0) {
+            // Keep one or two items queued across the wrap
+            continue;
+        }
+        while (ring.size() > 1) {
+            TEST_ASSERT_TRUE(ring.pop(item));
+        }
+    }
+    while (ring.pop(item)) {
+    }
+    TEST_ASSERT_EQUAL_UINT32(999, item.sequence);
+    TEST_ASSERT_EQUAL_UINT8(999 % 7, item.tag);
+}
+
+void test_interleaved_push_pop_keeps_fifo_order() {
+    SpscRing<uint32_t, 16> ring;
+    uint32_t next = 0;
+    uint32_t expected = 0;
+    uint32_t item;
+    for (int round = 0; round < 500; round++) {
+        int pushes = round % 13;
+        for (int i = 0; i < pushes && ring.push(next); i++) {
+            next++;
+        }
+        int pops = round % 11;
+        for (int i = 0; i < pops && ring.pop(item); i++) {
+            TEST_ASSERT_EQUAL_UINT32(expected++, item);
+        }
+    }
+    while (ring.pop(item)) {
+        TEST_ASSERT_EQUAL_UINT32(expected++, item);
+    }
+    TEST_ASSERT_EQUAL_UINT32(next, expected);
+}
+
+void test_two_threads_lose_and_reorder_nothing() {
+    static SpscRing<Item, 64> ring;
+    const uint32_t COUNT = 1000000;
+
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < COUNT;) {
+            if (ring.push({ i, (float)i, (uint8_t)i })) {
+                i++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // The payload must be complete when the index says so
+    uint32_t expected = 0;
+    bool intact = true;
+    Item item;
+    while (expected < COUNT) {
+        if (!ring.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        intact = intact && item.sequence == expected && item.value == (float)expected &&
+                 item.tag == (uint8_t)expected;
+        expected++;
+    }
+    producer.join();
+    TEST_ASSERT_TRUE(intact);
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_ring_pops_nothing);
+    RUN_TEST(test_holds_capacity_minus_one);
+    RUN_TEST(test_indices_wrap_around);
+    RUN_TEST(test_interleaved_push_pop_keeps_fifo_order);
+    RUN_TEST(test_two_threads_lose_and_reorder_nothing);
+    return UNITY_END();
+}
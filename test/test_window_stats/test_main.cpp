@@ -0,0 +1,169 @@
+#include <unity.h>
+#include <random>
+#include <vector>
+#include "WindowStats.h"
+
+// Sliding window min/max/mean against a brute-force scan, see WindowStats
+
+struct Reading {
+    uint32_t epoch;
+    int16_t centiCelsius;
+};
+
+// What a window over the readings should report, recomputed from scratch
+struct Expected {
+    uint32_t count;
+    int32_t minimum;
+    int32_t maximum;
+    int64_t sum;
+    uint32_t oldest;
+    bool cut;       // Readings inside the window were dropped from the ring
+    bool aged;      // Some tracked reading is older than the window
+};
+
+// readings[tracked:] are the ones the windows have seen since setWindows()
+static Expected scan(const std::vector<Reading>& readings, size_t tracked, uint16_t capacity, uint32_t seconds) {
+    Expected expected = { 0, INT32_MAX, INT32_MIN, 0, 0, false, false };
+    uint32_t newest = readings.back().epoch;
+    size_t kept = readings.size() > capacity ? readings.size() - capacity : 0;
+    for (size_t i = tracked; i < readings.size(); i++) {
+        const Reading& reading = readings[i];
+        if (reading.epoch + seconds <= newest) {
+            expected.aged = true;
+            continue;
+        }
+        if (i < kept) {
+            expected.cut = true;
+            continue;
+        }
+        if (expected.count == 0) {
+            expected.oldest = reading.epoch;
+        }
+        expected.count++;
+        expected.minimum = std::min<int32_t>(expected.minimum, reading.centiCelsius);
+        expected.maximum = std::max<int32_t>(expected.maximum, reading.centiCelsius);
+        expected.sum += reading.centiCelsius;
+    }
+    return expected;
+}
+
+static void pickWindows(std::mt19937& random, uint32_t* seconds, uint8_t& count) {
+    count = 1 + random() % WindowStats::MAX_WINDOWS;
+    for (uint8_t i = 0; i < count; i++) {
+        seconds[i] = 1 + random() % 400;
+    }
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_matches_brute_force() {
+    std::mt19937 random(7);
+    char message[128];
+
+    for (int run = 0; run < 300; run++) {
+        uint16_t capacity = 1 + random() % 200;
+        WindowStats stats(capacity);
+        uint32_t seconds[WindowStats::MAX_WINDOWS];
+        uint8_t windowCount;
+        pickWindows(random, seconds, windowCount);
+        stats.setWindows(seconds, windowCount);
+
+        std::vector<Reading> readings;
+        size_t tracked = 0;
+        uint32_t epoch = 1700000000;
+        int steps = random() % 3000;
+        for (int step = 0; step < steps; step++) {
+            // Irregular spacing: repeated timestamps, short steps and long gaps,
+            // with the occasional wild value
+            int kind = random() % 10;
+            epoch += kind == 0 ? 0 : kind < 8 ? 1 + random() % 5 : random() % 100;
+            int value = (int)(random() % 200) - 100;
+            if (kind == 9) {
+                value += (int)(random() % 20000) - 10000;
+            }
+            stats.add(epoch, (int16_t)value);
+            readings.push_back({ epoch, (int16_t)value });
+
+            // Replace the windows mid-stream now and then
+            if (random() % 50 == 0) {
+                pickWindows(random, seconds, windowCount);
+                stats.setWindows(seconds, windowCount);
+                tracked = readings.size() > capacity ? readings.size() - capacity : 0;
+            }
+
+            for (uint8_t w = 0; w < windowCount; w++) {
+                snprintf(message, sizeof(message), "run %d step %d capacity %u window %lus",
+                         run, step, capacity, (unsigned long)seconds[w]);
+                Expected expected = scan(readings, tracked, capacity, seconds[w]);
+                WindowStats::Result result;
+                bool found = stats.get(seconds[w], result);
+                TEST_ASSERT_EQUAL_MESSAGE(expected.count > 0, found, message);
+                if (!found) {
+                    continue;
+                }
+                TEST_ASSERT_EQUAL_UINT32_MESSAGE(expected.count, result.count, message);
+                TEST_ASSERT_EQUAL_INT16_MESSAGE(expected.minimum, result.minCentiCelsius, message);
+                TEST_ASSERT_EQUAL_INT16_MESSAGE(expected.maximum, result.maxCentiCelsius, message);
+                TEST_ASSERT_FLOAT_WITHIN_MESSAGE(0.01f, (float)expected.sum / expected.count,
+                                                 result.meanCentiCelsius, message);
+                TEST_ASSERT_EQUAL_UINT32_MESSAGE(epoch - expected.oldest, result.spanSeconds, message);
+                TEST_ASSERT_EQUAL_MESSAGE(expected.cut, result.truncated, message);
+                if (result.full) {
+                    TEST_ASSERT_TRUE_MESSAGE(expected.aged, message);
+                }
+            }
+        }
+    }
+}
+
+void test_single_slot_ring_keeps_the_newest_reading() {
+    WindowStats stats(1);
+    uint32_t seconds[] = { 60 };
+    stats.setWindows(seconds, 1);
+
+    stats.add(1000, 2000);
+    stats.add(1010, 1500);
+    WindowStats::Result result;
+    TEST_ASSERT_TRUE(stats.get(60, result));
+    TEST_ASSERT_EQUAL_UINT32(1, result.count);
+    TEST_ASSERT_EQUAL_INT16(1500, result.minCentiCelsius);
+    TEST_ASSERT_EQUAL_INT16(1500, result.maxCentiCelsius);
+    TEST_ASSERT_TRUE(result.truncated);
+    TEST_ASSERT_FALSE(result.full);
+
+    // The dropped reading has aged out by now, so nothing is missing
+    stats.add(1080, 1800);
+    TEST_ASSERT_TRUE(stats.get(60, result));
+    TEST_ASSERT_FALSE(result.truncated);
+}
+
+void test_new_windows_are_filled_from_kept_readings() {
+    WindowStats stats(100);
+    for (uint32_t i = 0; i < 50; i++) {
+        stats.add(1000 + i * 10, (int16_t)(2000 + i));
+    }
+
+    uint32_t seconds[] = { 100, 1000 };
+    stats.setWindows(seconds, 2);
+    WindowStats::Result result;
+    TEST_ASSERT_TRUE(stats.get(100, result));
+    TEST_ASSERT_EQUAL_UINT32(10, result.count);
+    TEST_ASSERT_EQUAL_INT16(2040, result.minCentiCelsius);
+    TEST_ASSERT_TRUE(result.full);
+    TEST_ASSERT_TRUE(stats.get(1000, result));
+    TEST_ASSERT_EQUAL_UINT32(50, result.count);
+    TEST_ASSERT_FALSE(result.full);
+    TEST_ASSERT_FALSE(stats.get(60, result));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_brute_force);
+    RUN_TEST(test_single_slot_ring_keeps_the_newest_reading);
+    RUN_TEST(test_new_windows_are_filled_from_kept_readings);
+    return UNITY_END();
+}